@@ -0,0 +1,27 @@
+@echo off
+echo Building RPG combat benchmark...
+echo.
+
+:: Check if g++ is available
+where g++ >nul 2>&1
+if %errorlevel% neq 0 (
+    echo Error: g++ compiler not found!
+    echo Please install MinGW-w64 or Visual Studio Build Tools
+    pause
+    exit /b 1
+)
+
+:: Build with the same flags as build_rpg.bat so numbers are comparable
+g++ -std=c++17 -Wall -Wextra -O2 -o rpg_bench.exe rpg.cpp
+if %errorlevel% neq 0 (
+    echo.
+    echo ❌ Build failed!
+    pause
+    exit /b 1
+)
+
+:: Run the headless benchmark and keep a history across builds
+echo ==== %DATE% %TIME% ==== >> bench_history.txt
+rpg_bench.exe --bench >> bench_history.txt
+type bench_history.txt
+pause
@@ -0,0 +1,89 @@
+// Buffered console output shared by game.cpp and rpg.cpp.
+#pragma once
+
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// Game screens are assembled in one reusable buffer and written with a
+// single write call when presented (before each wait for input), rather
+// than streamed line by line. With `render` off nothing is formatted at
+// all, which is the no-render mode used by piped, scripted and replayed
+// sessions.
+class Frame {
+public:
+    bool render = true;
+    long long frames = 0;  // presented frames
+    long long bytes = 0;   // bytes handed to the OS
+    long long writes = 0;  // write calls issued
+
+    Frame() { buf.reserve(16 * 1024); }
+
+    Frame& operator<<(std::string_view s) { if (render) buf.append(s.data(), s.size()); return *this; }
+    Frame& operator<<(const char* s) { if (render) buf.append(s); return *this; }
+    Frame& operator<<(char c) { if (render) buf.push_back(c); return *this; }
+    Frame& operator<<(int v) { return number(v); }
+    Frame& operator<<(long long v) { return number(v); }
+    Frame& operator<<(size_t v) { return number(v); }
+
+    // ANSI clear + home; replaces spawning `cls`/`clear` through system().
+    void clearScreen() { if (render) buf += "\x1b[2J\x1b[H"; }
+
+    std::string_view pending() const { return buf; }
+    void discard() { buf.clear(); }
+
+    void present() {
+        if (buf.empty()) return;
+        frames++;
+        writeAll(buf.data(), buf.size());
+        buf.clear();
+    }
+
+    // Redirects presented frames, e.g. to the null device for benchmarks.
+#ifdef _WIN32
+    void setOutput(HANDLE h) { out = h; }
+#else
+    void setOutput(int fd) { out = fd; }
+#endif
+
+private:
+    std::string buf;
+#ifdef _WIN32
+    HANDLE out = GetStdHandle(STD_OUTPUT_HANDLE);
+#else
+    int out = 1;
+#endif
+
+    template <typename T> Frame& number(T v) {
+        if (!render) return *this;
+        char tmp[24];
+        auto r = std::to_chars(tmp, tmp + sizeof tmp, v);
+        buf.append(tmp, r.ptr);
+        return *this;
+    }
+
+    void writeAll(const char* p, size_t n) {
+        while (n > 0) {
+            writes++;
+#ifdef _WIN32
+            DWORD done = 0;
+            if (!WriteFile(out, p, (DWORD)n, &done, nullptr) || done == 0) return;
+#else
+            ssize_t done = ::write(out, p, n);
+            if (done < 0 && errno == EINTR) continue;
+            if (done <= 0) return;
+#endif
+            bytes += done; p += done; n -= (size_t)done;
+        }
+    }
+};
@@ -1,67 +1,116 @@
 #include <iostream>
 #include <random>
 #include <string>
+#include <string_view>
 #include <limits>
+#include <charconv>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include <vector>
+#include "rng.h"
+#include "input.h"
+#include "frame.h"
+#include "session_log.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <cerrno>
+#include <thread>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+Frame screen;
+
+// The guessing game's session logs (see session_log.h); the final digest
+// sums up the games played.
+namespace SessionLog {
+    constexpr char magic[4] = { 'G', 'T', 'N', 'L' };
+}
+
+Input input(SessionLog::magic);
 
 class NumberGuessGame {
 private:
     int secretNumber;
     int attempts;
     int maxAttempts;
-    std::random_device rd;
-    std::mt19937 gen;
-    std::uniform_int_distribution<> dis;
+    int minNumber, maxNumber;
+    Rand::Source<Rand::Engine> rng;
 
 public:
-    NumberGuessGame(int min = 1, int max = 100, int maxTries = 10) 
-        : gen(rd()), dis(min, max), maxAttempts(maxTries), attempts(0) {
-        secretNumber = dis(gen);
+    NumberGuessGame(unsigned seed, int min = 1, int max = 100, int maxTries = 10)
+        : attempts(0), maxAttempts(maxTries), minNumber(min), maxNumber(max), rng(seed) {
+        secretNumber = rng.range(minNumber, maxNumber);
     }
 
     void displayWelcome() {
-        std::cout << "========================================\n";
-        std::cout << "    Welcome to GUESS THE NUMBER!       \n";
-        std::cout << "========================================\n";
-        std::cout << "I'm thinking of a number between 1-100\n";
-        std::cout << "You have " << maxAttempts << " attempts to guess it!\n";
-        std::cout << "========================================\n\n";
+        screen << "========================================\n";
+        screen << "    Welcome to GUESS THE NUMBER!       \n";
+        screen << "========================================\n";
+        screen << "I'm thinking of a number between 1-100\n";
+        screen << "You have " << maxAttempts << " attempts to guess it!\n";
+        screen << "========================================\n\n";
     }
 
     void displayStats() {
-        std::cout << "Attempts remaining: " << (maxAttempts - attempts) << "\n";
-        std::cout << "Enter your guess: ";
+        screen << "Attempts remaining: " << (maxAttempts - attempts) << "\n";
+        screen << "Enter your guess: ";
     }
 
-    int getPlayerGuess() {
-        int guess;
+    // False once input runs out.
+    bool getPlayerGuess(int& guess) {
         while (true) {
-            if (std::cin >> guess) {
+            screen.present();
+            std::string_view line;
+            if (!input.line(line)) return false;
+            size_t start = line.find_first_not_of(" \t");
+            if (start == std::string_view::npos) continue;  // blank lines are skipped
+            const char* first = line.data() + start;
+            if (*first == '+') ++first;
+            if (std::from_chars(first, line.data() + line.size(), guess).ec == std::errc()) {
                 if (guess >= 1 && guess <= 100) {
-                    return guess;
+                    return true;
                 } else {
-                    std::cout << "Please enter a number between 1 and 100: ";
+                    screen << "Please enter a number between 1 and 100: ";
                 }
             } else {
-                std::cout << "Invalid input! Please enter a number: ";
-                std::cin.clear();
-                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                screen << "Invalid input! Please enter a number: ";
             }
         }
     }
 
     bool processGuess(int guess) {
         attempts++;
-        
+
         if (guess == secretNumber) {
-            std::cout << "\n🎉 CONGRATULATIONS! 🎉\n";
-            std::cout << "You guessed it in " << attempts << " attempts!\n";
+            screen << "\n🎉 CONGRATULATIONS! 🎉\n";
+            screen << "You guessed it in " << attempts << " attempts!\n";
             return true;
         } else if (guess < secretNumber) {
-            std::cout << "📈 Too low! Try a higher number.\n\n";
+            screen << "📈 Too low! Try a higher number.\n\n";
         } else {
-            std::cout << "📉 Too high! Try a lower number.\n\n";
+            screen << "📉 Too high! Try a lower number.\n\n";
         }
-        
+
         return false;
     }
 
@@ -69,42 +118,156 @@ public:
         return attempts >= maxAttempts;
     }
 
+    int getAttempts() const {
+        return attempts;
+    }
+
+    // -1 if guess is too low, 1 if too high, 0 if correct; no attempt used.
+    int hint(int guess) const {
+        return guess < secretNumber ? -1 : guess > secretNumber ? 1 : 0;
+    }
+
     void displayGameOver() {
-        std::cout << "\n💀 GAME OVER! 💀\n";
-        std::cout << "The number was: " << secretNumber << "\n";
-        std::cout << "Better luck next time!\n";
+        screen << "\n💀 GAME OVER! 💀\n";
+        screen << "The number was: " << secretNumber << "\n";
+        screen << "Better luck next time!\n";
     }
 
     void resetGame() {
-        secretNumber = dis(gen);
+        secretNumber = rng.range(minNumber, maxNumber);
         attempts = 0;
     }
 };
 
+// Optimal guessing. Splitting the possible numbers so they form a complete
+// binary search tree (every level full but the last) is optimal both ways:
+// it never needs more than ceil(log2(n+1)) guesses, the minimax bound, and
+// it minimizes the expected guesses for a uniformly drawn secret. With too
+// few tries it still wins on 2^tries - 1 secrets, the most any strategy can.
+namespace Solver {
+    constexpr int tableMax = 255;
+
+    inline int floorLog2(uint64_t v) {
+#if defined(_MSC_VER)
+        unsigned long i; _BitScanReverse64(&i, v); return (int)i;
+#else
+        return 63 - __builtin_clzll(v);
+#endif
+    }
+
+    // Keys left of the root in a complete BST on n >= 1 keys.
+    inline uint64_t leftSize(uint64_t n) {
+        int d = floorLog2(n + 1);
+        uint64_t half = uint64_t(1) << (d - 1);
+        return half - 1 + std::min(n - ((half << 1) - 1), half);
+    }
+
+    // Sum of guesses over all n secrets when every one can be reached.
+    inline uint64_t completeCost(uint64_t n) {
+        if (n == 0) return 0;
+        int d = floorLog2(n + 1);
+        uint64_t full = (uint64_t(1) << d) - 1;
+        return (uint64_t)(d - 1) * (full + 1) + 1 + (n - full) * (uint64_t)(d + 1);
+    }
+
+    // Exhaustive optimum for small ranges, found at compile time:
+    // cost[n] = n + min over k of cost[k] + cost[n-1-k], pick[n] the best k
+    // (the one nearest the middle among ties).
+    struct Table {
+        uint32_t cost[tableMax + 1];
+        uint8_t pick[tableMax + 1];
+    };
+
+    constexpr Table buildTable() {
+        Table t{};
+        for (int n = 1; n <= tableMax; ++n) {
+            uint32_t best = ~0u;
+            for (int k = 0; k < n; ++k) {
+                uint32_t c = t.cost[k] + t.cost[n - 1 - k];
+                int skew = 2 * k - (n - 1), bestSkew = 2 * t.pick[n] - (n - 1);
+                if (c < best || (c == best && skew * skew < bestSkew * bestSkew)) { best = c; t.pick[n] = (uint8_t)k; }
+            }
+            t.cost[n] = best + (uint32_t)n;
+        }
+        return t;
+    }
+
+    constexpr Table table = buildTable();
+
+    // Next guess for a secret in [lo, hi]: a table lookup for small ranges,
+    // O(1) bit arithmetic up to the full 2^32 values of an int.
+    inline int64_t guess(int64_t lo, int64_t hi) {
+        uint64_t n = (uint64_t)(hi - lo + 1);
+        return lo + (int64_t)(n <= (uint64_t)tableMax ? table.pick[n] : leftSize(n));
+    }
+
+    // Narrows [lo, hi] on a hint from NumberGuessGame::hint().
+    class Bot {
+    public:
+        Bot(int64_t lo, int64_t hi) : lo(lo), hi(hi) {}
+
+        int next() const { return (int)guess(lo, hi); }
+
+        void feedback(int g, int hint) {
+            if (hint < 0) lo = (int64_t)g + 1;
+            else if (hint > 0) hi = (int64_t)g - 1;
+        }
+
+    private:
+        int64_t lo, hi;
+    };
+
+    // Expected attempts and win chance with this strategy, n secrets and
+    // `tries` attempts per game.
+    struct Outlook { double attempts, winRate; };
+
+    inline Outlook outlook(uint64_t n, int tries) {
+        int d = floorLog2(n + 1);
+        int levels = std::min(d, tries);
+        uint64_t covered = (uint64_t(1) << levels) - 1, rest = n - covered;
+        double cost = (double)completeCost(covered) + (double)rest * std::min(d + 1, tries);
+        double wins = (double)covered + (tries > d ? (double)rest : 0.0);
+        return { cost / (double)n, wins / (double)n };
+    }
+}
+
 class GameManager {
 public:
+    long long gamesPlayed = 0;
+    long long gamesWon = 0;
+    long long totalGuesses = 0;
+
+    explicit GameManager(unsigned seed) : seed(seed) {}
+
     void run() {
-        NumberGuessGame game;
+        NumberGuessGame game(seed);
         bool playAgain = true;
 
         while (playAgain) {
             game.displayWelcome();
-            
+            gamesPlayed++;
+
             // Main game loop
             while (true) {
                 game.displayStats();
-                int guess = game.getPlayerGuess();
-                
+                int guess;
+                if (!game.getPlayerGuess(guess)) {
+                    screen.present();
+                    return; // Out of input
+                }
+
                 if (game.processGuess(guess)) {
+                    gamesWon++;
                     break; // Player won
                 }
-                
+
                 if (game.isGameOver()) {
                     game.displayGameOver();
                     break; // Game over
                 }
             }
-            
+            totalGuesses += game.getAttempts();
+
             // Ask to play again
             playAgain = askPlayAgain();
             if (playAgain) {
@@ -112,30 +275,651 @@ public:
                 clearScreen();
             }
         }
-        
-        std::cout << "\nThanks for playing! Goodbye! 👋\n";
+
+        screen << "\nThanks for playing! Goodbye! 👋\n";
+        screen.present();
+    }
+
+    // Summary of the session, to check a replay against its recording.
+    uint64_t digest() const {
+        uint64_t h = 1469598103934665603ULL;
+        for (long long v : { gamesPlayed, gamesWon, totalGuesses }) { h ^= (uint64_t)v; h *= 1099511628211ULL; }
+        return h;
     }
 
 private:
+    unsigned seed;
+
     bool askPlayAgain() {
-        std::string response;
-        std::cout << "\nWould you like to play again? (y/n): ";
-        std::cin >> response;
-        
+        screen << "\nWould you like to play again? (y/n): ";
+        screen.present();
+        std::string_view line;
+        if (!input.line(line)) return false;
+        size_t start = line.find_first_not_of(" \t");
+        std::string_view response = start == std::string_view::npos ? std::string_view() : line.substr(start, line.find_first_of(" \t", start) - start);
+
         return (response == "y" || response == "Y" || response == "yes" || response == "Yes");
     }
-    
+
     void clearScreen() {
-        #ifdef _WIN32
-            system("cls");
-        #else
-            system("clear");
-        #endif
+        screen.clearScreen();
     }
 };
 
-int main() {
-    GameManager gameManager;
+// game --replay <log>: replays a recorded session without terminal output
+// and checks it ends the way the recording did.
+int runReplay(const std::string& path) {
+    uint64_t seed;
+    std::string_view extra;
+    std::string error;
+    if (!input.startReplay(path, seed, extra, error)) { std::cerr << error << "\n"; return 1; }
+    screen.render = false;
+    GameManager gameManager((unsigned)seed);
+    auto t0 = std::chrono::steady_clock::now();
+    gameManager.run();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << std::fixed << std::setprecision(1) << "Replayed " << input.lines << " inputs (" << input.logBytes() << " bytes) in "
+              << secs * 1000 << " ms: " << input.lines / secs << " inputs/sec\n"
+              << "Games: " << gameManager.gamesPlayed << "  Won: " << gameManager.gamesWon << "  Guesses: " << gameManager.totalGuesses << "\n";
+    uint64_t recorded;
+    if (!input.recordedDigest(recorded)) { std::cout << "No final state recorded (session did not end normally)\n"; return 0; }
+    bool match = recorded == gameManager.digest();
+    std::cout << "Recorded digest " << (match ? "MATCH" : "MISMATCH") << "\n";
+    return match ? 0 : 1;
+}
+
+// game --replay-bench [inputs]: replays a synthetic log of about `inputs`
+// lines: binary-search games, each followed by "y" to play again. The log
+// is produced by a shadow game on the same seed, so it stays in step.
+int runReplayBench(long long inputs) {
+    const std::string path = "replay_bench.log";
+    const unsigned seed = 77;
+    std::string log = SessionLog::start(SessionLog::magic, seed);
+    NumberGuessGame shadow(seed);
+    GameManager expected(seed);
+    long long lines = 0;
+    while (lines < inputs) {
+        int lo = 1, hi = 100;
+        while (true) {
+            int guess = (lo + hi) / 2, hint = shadow.hint(guess);
+            SessionLog::putInput(log, std::to_string(guess));
+            lines++;
+            expected.totalGuesses++;
+            if (hint == 0) break;
+            if (hint < 0) lo = guess + 1; else hi = guess - 1;
+        }
+        expected.gamesPlayed++;
+        expected.gamesWon++;
+        SessionLog::putInput(log, lines + 1 < inputs ? "y" : "n");
+        lines++;
+        shadow.resetGame();
+    }
+    SessionLog::putEnd(log, expected.digest());
+    std::ofstream(path, std::ios::binary).write(log.data(), (std::streamsize)log.size());
+    std::ostringstream report;
+    auto* saved = std::cout.rdbuf(report.rdbuf());
+    int rc = runReplay(path);
+    std::cout.rdbuf(saved);
+    std::remove(path.c_str());
+    std::cout << "Log: " << log.size() << " bytes (" << std::fixed << std::setprecision(1) << (double)log.size() / lines << " bytes/input)\n"
+              << report.str();
+    return rc;
+}
+
+// Plays `games` games on [min, max] with `tries` attempts each, the solver
+// against processGuess(), and reports how it did next to the prediction.
+bool benchSolver(long long games, int min, int max, int tries) {
+    bool savedRender = screen.render;
+    screen.render = false;
+    NumberGuessGame game(12345, min, max, tries);
+    long long won = 0, attempts = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (long long i = 0; i < games; ++i) {
+        Solver::Bot bot(min, max);
+        while (true) {
+            int g = bot.next();
+            if (game.processGuess(g)) { won++; break; }
+            if (game.isGameOver()) break;
+            bot.feedback(g, game.hint(g));
+        }
+        attempts += game.getAttempts();
+        game.resetGame();
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    screen.render = savedRender;
+    Solver::Outlook o = Solver::outlook((uint64_t)((int64_t)max - min + 1), tries);
+    double avg = (double)attempts / games, winRate = (double)won / games;
+    std::cout << std::fixed << std::setprecision(1) << "[" << min << ", " << max << "] " << tries << " tries: "
+              << games / secs / 1e6 << "M games/sec  avg attempts " << std::setprecision(3) << avg
+              << " (optimal " << o.attempts << ")  won " << std::setprecision(2) << 100 * winRate
+              << "% (optimal " << 100 * o.winRate << "%)\n";
+    // Sampled secrets: allow a few standard errors around the prediction.
+    return std::abs(avg - o.attempts) < 0.05 * o.attempts + 0.01 && std::abs(winRate - o.winRate) < 0.01;
+}
+
+// game --solver-bench [games] [min max [tries]]: solver throughput and
+// average attempts, on the given range or on a set of preset ranges. Game
+// counts below 100000 are raised to it: fewer games leave the sampled win
+// rate too noisy for the 1% check against the prediction.
+int runSolverBench(long long games, int argc, char** argv) {
+    games = std::max(100000LL, games);
+    struct Range { int min, max, tries; };
+    std::vector<Range> ranges;
+    if (argc > 1) {
+        Range r{ std::atoi(argv[0]), std::atoi(argv[1]), argc > 2 ? std::atoi(argv[2]) : 32 };
+        if (r.min > r.max || r.tries < 1) { std::cerr << "need min <= max and tries >= 1\n"; return 1; }
+        ranges.push_back(r);
+    } else {
+        ranges = { { 1, 100, 10 }, { 1, 100, 5 }, { 1, 255, 8 }, { 1, 1000000, 20 },
+                   { std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), 32 } };
+    }
+    bool ok = true;
+    for (const Range& r : ranges) ok &= benchSolver(games, r.min, r.max, r.tries);
+    if (!ok) std::cout << "Average attempts or win rate off the prediction\n";
+    return ok ? 0 : 1;
+}
+
+// game --solver-check: the compile-time table matches the exhaustive
+// optimum, and for every range size up to 2000 and every try limit the
+// solver's exact totals over all secrets match Solver::outlook().
+int runSolverCheck() {
+    int failures = 0;
+    for (int n = 1; n <= Solver::tableMax; ++n) {
+        if (Solver::table.cost[n] != Solver::completeCost((uint64_t)n)) {
+            std::cout << "table cost " << n << ": " << Solver::table.cost[n] << " vs complete tree " << Solver::completeCost((uint64_t)n) << "\n";
+            failures++;
+        }
+    }
+    for (int n = 1; n <= 2000; ++n) {
+        for (int tries = 1; tries <= 12; ++tries) {
+            long long attempts = 0, won = 0;
+            for (int secret = 0; secret < n; ++secret) {
+                Solver::Bot bot(0, n - 1);
+                for (int t = 1; t <= tries; ++t) {
+                    int g = bot.next();
+                    int hint = g < secret ? -1 : g > secret ? 1 : 0;
+                    attempts++;
+                    if (hint == 0) { won++; break; }
+                    bot.feedback(g, hint);
+                }
+            }
+            Solver::Outlook o = Solver::outlook((uint64_t)n, tries);
+            if (std::abs(o.attempts * n - attempts) > 1e-6 || std::abs(o.winRate * n - won) > 1e-6) {
+                if (failures++ < 10) std::cout << "n " << n << " tries " << tries << ": " << attempts << " attempts, " << won << " won\n";
+            }
+        }
+    }
+    std::cout << (failures ? "FAIL" : "PASS") << ": solver optimal for table sizes 1-" << Solver::tableMax
+              << ", exact over all secrets for ranges 1-2000\n";
+    return failures ? 1 : 0;
+}
+
+// game --bot [games] [seed]: the solver plays visibly in place of a human.
+int runBot(long long games, unsigned seed) {
+    NumberGuessGame game(seed);
+    long long won = 0;
+    for (long long i = 0; i < games; ++i) {
+        game.displayWelcome();
+        Solver::Bot bot(1, 100);
+        while (true) {
+            game.displayStats();
+            int g = bot.next();
+            screen << g << "\n";
+            if (game.processGuess(g)) { won++; break; }
+            if (game.isGameOver()) { game.displayGameOver(); break; }
+            bot.feedback(g, game.hint(g));
+        }
+        screen.present();
+        game.resetGame();
+    }
+    screen << "\nBot won " << (int)won << " of " << (int)games << " games\n";
+    screen.present();
+    return 0;
+}
+
+#ifdef __linux__
+// Many games in one process: an epoll loop plays NumberGuessGame's rules
+// with thousands of clients over a Unix domain socket. One line each way:
+// the server greets with "ready <min> <max> <tries>", then answers each
+// guess with "low", "high", "win <attempts>" or "lose <secret>" (the next
+// game starts right away), or "invalid"/"range" without using an attempt.
+namespace GuessServer {
+    struct Config { int min = 1, max = 100, tries = 10; uint64_t seed = 1; };
+
+    // One connected player: the round and an 8-byte generator, so tens of
+    // thousands fit in a couple of MB.
+    struct Session {
+        Rand::SplitMix64 rng;
+        int32_t fd;       // -1: slot is free
+        int32_t secret;
+        uint16_t attempts;
+        uint8_t inLen;
+        bool discarding;  // inside an overlong line: drop input up to '\n'
+        char in[12];      // unfinished input line
+    };
+    static_assert(sizeof(Session) == 32, "sessions should stay compact");
+
+    class Server {
+    public:
+        long long opened = 0, guesses = 0;
+        size_t peak = 0;
+
+        explicit Server(const Config& cfg) : cfg(cfg) { out.reserve(1 << 16); }
+
+        ~Server() {
+            for (Session& s : pool) if (s.fd >= 0) ::close(s.fd);
+            for (int fd : { listenFd, epollFd, wakeFd }) if (fd >= 0) ::close(fd);
+            if (!path.empty()) unlink(path.c_str());
+        }
+
+        bool listen(const std::string& socketPath, std::string& error) {
+            sockaddr_un addr{};
+            if (socketPath.size() >= sizeof addr.sun_path) { error = "socket path too long"; return false; }
+            addr.sun_family = AF_UNIX;
+            std::memcpy(addr.sun_path, socketPath.c_str(), socketPath.size() + 1);
+            unlink(socketPath.c_str());
+            listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (listenFd < 0 || bind(listenFd, (sockaddr*)&addr, sizeof addr) < 0 || ::listen(listenFd, SOMAXCONN) < 0) {
+                error = "cannot listen on " + socketPath + ": " + std::strerror(errno);
+                return false;
+            }
+            path = socketPath;
+            epollFd = epoll_create1(EPOLL_CLOEXEC);
+            wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (epollFd < 0 || wakeFd < 0) { error = std::string("epoll: ") + std::strerror(errno); return false; }
+            watch(listenFd, listenTag);
+            watch(wakeFd, wakeTag);
+            return true;
+        }
+
+        // Serves until stop() is called from another thread.
+        void run() {
+            epoll_event events[256];
+            while (!stopping) {
+                int n = epoll_wait(epollFd, events, 256, -1);
+                if (n < 0 && errno != EINTR) break;
+                for (int i = 0; i < n; ++i) {
+                    uint64_t tag = events[i].data.u64;
+                    if (tag == listenTag) acceptAll();
+                    else if (tag == wakeTag) stopping = true;
+                    else onReadable((uint32_t)tag);
+                }
+            }
+        }
+
+        void stop() { uint64_t one = 1; (void)!write(wakeFd, &one, sizeof one); }
+
+    private:
+        static constexpr uint64_t listenTag = ~0ULL, wakeTag = ~0ULL - 1;
+
+        Config cfg;
+        std::string path;
+        int listenFd = -1, epollFd = -1, wakeFd = -1;
+        bool stopping = false, acceptPaused = false;
+        std::vector<Session> pool;
+        std::vector<uint32_t> freeSlots;
+        std::string out;  // replies to one read, sent with a single write
+
+        void watch(int fd, uint64_t tag, int op = EPOLL_CTL_ADD, uint32_t events = EPOLLIN) {
+            epoll_event ev{};
+            ev.events = events;
+            ev.data.u64 = tag;
+            epoll_ctl(epollFd, op, fd, &ev);
+        }
+
+        void newRound(Session& s) {
+            s.secret = Rand::range(s.rng, cfg.min, cfg.max);
+            s.attempts = 0;
+        }
+
+        void appendInt(long long v) {
+            char tmp[24];
+            auto r = std::to_chars(tmp, tmp + sizeof tmp, v);
+            out.append(tmp, r.ptr);
+        }
+
+        void acceptAll() {
+            while (true) {
+                int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) {
+                    // Out of descriptors: the pending connection stays queued and the
+                    // listener stays readable, so stop watching it until a session
+                    // closes rather than spin on epoll_wait.
+                    if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                        watch(listenFd, listenTag, EPOLL_CTL_MOD, 0);
+                        acceptPaused = true;
+                    }
+                    return;
+                }
+                uint32_t slot;
+                if (!freeSlots.empty()) { slot = freeSlots.back(); freeSlots.pop_back(); }
+                else { slot = (uint32_t)pool.size(); pool.emplace_back(); }
+                Session& s = pool[slot];
+                s = Session{};
+                s.fd = fd;
+                s.rng.seed(cfg.seed ^ ((uint64_t)++opened * 0xD1B54A32D192ED03ULL));
+                newRound(s);
+                peak = std::max(peak, pool.size() - freeSlots.size());
+                watch(fd, slot);
+                out = "ready ";
+                appendInt(cfg.min); out += ' '; appendInt(cfg.max); out += ' '; appendInt(cfg.tries); out += '\n';
+                if (!flush(s)) close(slot);
+            }
+        }
+
+        void close(uint32_t slot) {
+            ::close(pool[slot].fd);  // also drops it from the epoll set
+            pool[slot].fd = -1;
+            freeSlots.push_back(slot);
+            if (acceptPaused) { watch(listenFd, listenTag, EPOLL_CTL_MOD); acceptPaused = false; }
+        }
+
+        // Replies are tiny and a client waits for each one, so a full socket
+        // buffer means the client stopped reading: it is dropped. So is one
+        // that already hung up (MSG_NOSIGNAL: no SIGPIPE).
+        bool flush(Session& s) {
+            ssize_t n = out.empty() ? 0 : send(s.fd, out.data(), out.size(), MSG_NOSIGNAL);
+            bool ok = n == (ssize_t)out.size();
+            out.clear();
+            return ok;
+        }
+
+        void onReadable(uint32_t slot) {
+            Session& s = pool[slot];
+            char buf[4096 + sizeof s.in];
+            std::memcpy(buf, s.in, s.inLen);
+            ssize_t n = read(s.fd, buf + s.inLen, 4096);
+            if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+            if (n <= 0) { close(slot); return; }
+            size_t len = s.inLen + (size_t)n, start = 0;
+            for (size_t i = s.inLen; i < len; ++i) {
+                if (buf[i] != '\n') continue;
+                if (s.discarding) s.discarding = false;  // end of an overlong line
+                else onLine(s, std::string_view(buf + start, i - start));
+                start = i + 1;
+            }
+            s.inLen = 0;
+            if (!s.discarding && len - start > sizeof s.in) {
+                out += "invalid\n";  // overlong line: answered once, the rest up to '\n' is dropped
+                s.discarding = true;
+            }
+            if (!s.discarding) { s.inLen = (uint8_t)(len - start); std::memcpy(s.in, buf + start, s.inLen); }
+            if (!flush(s)) close(slot);
+        }
+
+        // Same input rules as NumberGuessGame::getPlayerGuess().
+        void onLine(Session& s, std::string_view line) {
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            size_t start = line.find_first_not_of(" \t");
+            if (start == std::string_view::npos) return;
+            const char* first = line.data() + start;
+            if (*first == '+') ++first;
+            int guess;
+            if (std::from_chars(first, line.data() + line.size(), guess).ec != std::errc()) { out += "invalid\n"; return; }
+            if (guess < cfg.min || guess > cfg.max) { out += "range\n"; return; }
+            guesses++;
+            s.attempts++;
+            if (guess == s.secret) {
+                out += "win "; appendInt(s.attempts); out += '\n';
+                newRound(s);
+            } else if (s.attempts >= cfg.tries) {
+                out += "lose "; appendInt(s.secret); out += '\n';
+                newRound(s);
+            } else {
+                out += guess < s.secret ? "low\n" : "high\n";
+            }
+        }
+    };
+
+    // Load generator: keeps `concurrency` connections open, each playing
+    // `games` games with Solver::Bot and then making way for a new session,
+    // until `sessions` have finished.
+    struct LoadResult {
+        long long sessions = 0, games = 0, requests = 0, errors = 0;
+        double secs = 0;
+        std::vector<uint32_t> latencyNs;  // one per guess
+    };
+
+    class LoadClient {
+    public:
+        LoadClient(const std::string& path, int games) : path(path), games(games) {}
+
+        bool run(long long sessions, int concurrency, LoadResult& r, std::string& error) {
+            epollFd = epoll_create1(EPOLL_CLOEXEC);
+            if (epollFd < 0) { error = std::string("epoll: ") + std::strerror(errno); return false; }
+            clients.assign((size_t)concurrency, Client{});
+            long long started = 0;
+            auto t0 = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < clients.size() && started < sessions; ++i, ++started)
+                if (!connect(i, error)) return false;
+            int live = (int)std::min<long long>(sessions, concurrency);
+            epoll_event events[256];
+            while (live > 0) {
+                int n = epoll_wait(epollFd, events, 256, 1000);
+                if (n < 0 && errno != EINTR) { error = std::string("epoll: ") + std::strerror(errno); return false; }
+                if (n == 0) { error = "server stopped answering"; return false; }
+                for (int i = 0; i < n; ++i) {
+                    uint32_t slot = events[i].data.u32;
+                    if (onReadable(slot, r)) continue;
+                    ::close(clients[slot].fd);
+                    r.sessions++;
+                    if (started < sessions) { started++; if (!connect(slot, error)) return false; }
+                    else live--;
+                }
+            }
+            r.secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            ::close(epollFd);
+            return true;
+        }
+
+    private:
+        struct Client {
+            int fd = -1;
+            int gamesLeft = 0, min = 0, max = 0, guess = 0;
+            Solver::Bot bot{ 0, 0 };
+            std::chrono::steady_clock::time_point sentAt;
+            uint8_t inLen = 0;
+            char in[31];
+        };
+
+        std::string path;
+        int games;
+        int epollFd = -1;
+        std::vector<Client> clients;
+
+        bool connect(uint32_t slot, std::string& error) {
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::memcpy(addr.sun_path, path.c_str(), std::min(path.size() + 1, sizeof addr.sun_path - 1));
+            int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            // Blocking connect: waits while the server's accept backlog is full.
+            if (fd < 0 || ::connect(fd, (sockaddr*)&addr, sizeof addr) < 0) {
+                error = "cannot connect to " + path + ": " + std::strerror(errno);
+                if (fd >= 0) ::close(fd);
+                return false;
+            }
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            Client& c = clients[slot];
+            c = Client{};
+            c.fd = fd;
+            c.gamesLeft = games;
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.u32 = slot;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+            return true;
+        }
+
+        bool send(Client& c) {
+            c.guess = c.bot.next();
+            char line[16];
+            auto r = std::to_chars(line, line + sizeof line - 1, c.guess);
+            *r.ptr++ = '\n';
+            c.sentAt = std::chrono::steady_clock::now();
+            return write(c.fd, line, (size_t)(r.ptr - line)) == r.ptr - line;
+        }
+
+        // False once the session is over (or broken).
+        bool onReadable(uint32_t slot, LoadResult& r) {
+            Client& c = clients[slot];
+            char buf[512];
+            std::memcpy(buf, c.in, c.inLen);
+            ssize_t n = read(c.fd, buf + c.inLen, sizeof buf - c.inLen);
+            if (n < 0 && (errno == EAGAIN || errno == EINTR)) return true;
+            if (n <= 0) { r.errors++; return false; }
+            size_t len = c.inLen + (size_t)n, start = 0;
+            for (size_t i = c.inLen; i < len; ++i) {
+                if (buf[i] != '\n') continue;
+                std::string_view line(buf + start, i - start);
+                start = i + 1;
+                if (line.substr(0, 6) == "ready ") {
+                    std::istringstream in{ std::string(line.substr(6)) };
+                    if (!(in >> c.min >> c.max)) { r.errors++; return false; }
+                    c.bot = Solver::Bot(c.min, c.max);
+                } else {
+                    r.latencyNs.push_back((uint32_t)std::min<long long>(0xFFFFFFFFLL,
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - c.sentAt).count()));
+                    r.requests++;
+                    if (line == "low") c.bot.feedback(c.guess, -1);
+                    else if (line == "high") c.bot.feedback(c.guess, 1);
+                    else if (line.substr(0, 4) == "win " || line.substr(0, 5) == "lose ") {
+                        r.games++;
+                        if (--c.gamesLeft == 0) return false;
+                        c.bot = Solver::Bot(c.min, c.max);
+                    } else { r.errors++; return false; }
+                }
+                if (!send(c)) { r.errors++; return false; }
+            }
+            c.inLen = (uint8_t)std::min(len - start, sizeof c.in);
+            std::memcpy(c.in, buf + start, c.inLen);
+            return true;
+        }
+    };
+
+    // Each session holds two descriptors when client and server share a
+    // process, so lift the soft limit as far as the hard one allows.
+    inline long raiseFdLimit() {
+        rlimit lim{};
+        if (getrlimit(RLIMIT_NOFILE, &lim) != 0) return 1024;
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+        getrlimit(RLIMIT_NOFILE, &lim);
+        return lim.rlim_cur == RLIM_INFINITY ? 1L << 20 : (long)lim.rlim_cur;
+    }
+
+    inline void report(const LoadResult& r, int concurrency) {
+        std::vector<uint32_t> lat = r.latencyNs;
+        auto pct = [&](double q) -> double {
+            if (lat.empty()) return 0;
+            size_t k = std::min(lat.size() - 1, (size_t)(q * (double)lat.size()));
+            std::nth_element(lat.begin(), lat.begin() + (long)k, lat.end());
+            return lat[k] / 1000.0;
+        };
+        std::cout << std::fixed << std::setprecision(1) << std::setw(6) << concurrency << " concurrent: "
+                  << r.sessions / r.secs << " sessions/sec  " << r.games / r.secs << " games/sec  "
+                  << r.requests / r.secs / 1e3 << "k guesses/sec  latency p50 " << pct(0.50) << " us  p99 " << pct(0.99) << " us";
+        if (r.errors) std::cout << "  " << r.errors << " errors";
+        std::cout << "\n";
+    }
+}
+
+// game --serve [socket] [min max tries]: hosts games until interrupted.
+int runServe(const std::string& path, const GuessServer::Config& cfg) {
+    GuessServer::raiseFdLimit();
+    GuessServer::Server server(cfg);
+    std::string error;
+    if (!server.listen(path, error)) { std::cerr << error << "\n"; return 1; }
+    std::cout << "Serving [" << cfg.min << ", " << cfg.max << "], " << cfg.tries << " tries on " << path << "\n" << std::flush;
+    server.run();
+    return 0;
+}
+
+// game --load [socket] [sessions] [concurrency] [games]: drives a running
+// --serve instance.
+int runLoad(const std::string& path, long long sessions, int concurrency, int games) {
+    GuessServer::raiseFdLimit();
+    GuessServer::LoadResult r;
+    std::string error;
+    if (!GuessServer::LoadClient(path, games).run(sessions, concurrency, r, error)) { std::cerr << error << "\n"; return 1; }
+    GuessServer::report(r, concurrency);
+    return r.errors ? 1 : 0;
+}
+
+// game --serve-bench [sessions] [games]: server thread and load generator
+// in one process, at growing numbers of concurrent sessions.
+int runServeBench(long long sessions, int games) {
+    long fdLimit = GuessServer::raiseFdLimit();
+    const std::string path = "serve_bench.sock";
+    GuessServer::Config cfg;
+    GuessServer::Server server(cfg);
+    std::string error;
+    if (!server.listen(path, error)) { std::cerr << error << "\n"; return 1; }
+    std::thread serverThread([&] { server.run(); });
+    std::cout << "Session state: " << sizeof(GuessServer::Session) << " bytes (NumberGuessGame: " << sizeof(NumberGuessGame) << " bytes)\n";
+    int rc = 0;
+    for (int concurrency : { 10, 100, 1000, 5000, 10000 }) {
+        if (2L * concurrency + 64 > fdLimit) {
+            std::cout << std::setw(6) << concurrency << " concurrent: skipped, descriptor limit " << fdLimit << "\n";
+            continue;
+        }
+        GuessServer::LoadResult r;
+        if (!GuessServer::LoadClient(path, games).run(std::max<long long>(sessions, concurrency), concurrency, r, error)) {
+            std::cerr << error << "\n";
+            rc = 1;
+            break;
+        }
+        GuessServer::report(r, concurrency);
+        if (r.errors) rc = 1;
+    }
+    server.stop();
+    serverThread.join();
+    std::cout << "Peak sessions: " << server.peak << " (" << server.peak * sizeof(GuessServer::Session) / 1024.0 << " KB of session state)\n";
+    return rc;
+}
+#endif
+
+int main(int argc, char** argv) {
+#ifdef _WIN32
+    // UTF-8 output and ANSI escapes (colors, screen clear) on Windows consoles
+    SetConsoleOutputCP(65001);
+    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+    if (hOut != INVALID_HANDLE_VALUE) {
+        DWORD mode = 0; GetConsoleMode(hOut, &mode);
+        mode |= 0x0004; // ENABLE_VIRTUAL_TERMINAL_PROCESSING
+        SetConsoleMode(hOut, mode);
+    }
+#endif
+    std::string mode = argc > 1 ? argv[1] : "";
+    if (mode == "--replay" && argc > 2) return runReplay(argv[2]);
+    if (mode == "--replay-bench") return runReplayBench(argc > 2 ? std::atoll(argv[2]) : 100000);
+    if (mode == "--solver-bench") return runSolverBench(argc > 2 ? std::atoll(argv[2]) : 1000000, argc - 3, argv + 3);
+    if (mode == "--solver-check") return runSolverCheck();
+    if (mode == "--serve" || mode == "--load" || mode == "--serve-bench") {
+#ifdef __linux__
+        if (mode == "--serve-bench") return runServeBench(argc > 2 ? std::atoll(argv[2]) : 20000, argc > 3 ? std::atoi(argv[3]) : 3);
+        std::string path = argc > 2 ? argv[2] : "guess.sock";
+        if (mode == "--load") return runLoad(path, argc > 3 ? std::atoll(argv[3]) : 20000, argc > 4 ? std::atoi(argv[4]) : 1000, argc > 5 ? std::atoi(argv[5]) : 3);
+        GuessServer::Config cfg;
+        if (argc > 4) { cfg.min = std::atoi(argv[3]); cfg.max = std::atoi(argv[4]); }
+        if (argc > 5) cfg.tries = std::atoi(argv[5]);
+        if (cfg.min > cfg.max || cfg.tries < 1) { std::cerr << "need min <= max and tries >= 1\n"; return 1; }
+        cfg.seed = std::random_device{}();
+        return runServe(path, cfg);
+#else
+        std::cerr << mode << " needs Linux (epoll and Unix domain sockets)\n";
+        return 1;
+#endif
+    }
+    if (mode == "--bot") return runBot(argc > 2 ? std::atoll(argv[2]) : 1, argc > 3 ? (unsigned)std::atoll(argv[3]) : std::random_device{}());
+    if (mode == "--no-render") screen.render = false;
+
+    // --record <log> [seed]: play normally, logging the seed and every input.
+    unsigned seed = mode == "--record" && argc > 3 ? (unsigned)std::atoll(argv[3]) : std::random_device{}();
+    bool recording = mode == "--record" && argc > 2;
+    if (recording && !input.startRecording(argv[2], seed)) { std::cerr << "cannot write " << argv[2] << "\n"; return 1; }
+
+    GameManager gameManager(seed);
     gameManager.run();
+    if (recording) input.finish(gameManager.digest());
     return 0;
 }
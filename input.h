@@ -0,0 +1,139 @@
+// Buffered line reader shared by game.cpp and rpg.cpp.
+//
+// LineReader reads a descriptor (stdin by default) in 64 KB chunks with
+// plain read() calls, bypassing iostreams, and hands out lines as views
+// into its buffer. poll() never blocks, so a caller can keep working
+// (rendering, autosave) until a line arrives; line() blocks, and runs an
+// idle hook every time it has to wait.
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <vector>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <io.h>
+#else
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+class LineReader {
+public:
+    enum class Status { Line, Pending, End };
+
+    long long reads = 0;      // read() calls that returned data
+    long long bytesRead = 0;
+
+    // Called while line() waits for input, at least every idleMs.
+    void (*idle)(void* ctx) = nullptr;
+    void* idleCtx = nullptr;
+    int idleMs = 100;
+
+    explicit LineReader(int fd = 0, size_t chunk = 64 * 1024) : fd(fd), buf(chunk) {}
+
+    // The next line without its "\n" or "\r\n" if one is already buffered
+    // or can be read without blocking. The view stays valid until the next
+    // call. A last line without a newline is returned at end of input.
+    Status poll(std::string_view& out) {
+        if (take(out)) return Status::Line;
+        if (!atEnd && readable(0)) fill();
+        if (take(out)) return Status::Line;
+        if (!atEnd) return Status::Pending;
+        if (head == tail) return Status::End;
+        out = trim(std::string_view(buf.data() + head, tail - head));
+        head = scan = tail;
+        return Status::Line;
+    }
+
+    // Blocks until the next line; false at end of input.
+    bool line(std::string_view& out) {
+        while (true) {
+            Status s = poll(out);
+            if (s != Status::Pending) return s == Status::Line;
+            if (idle) {
+                idle(idleCtx);
+                readable(idleMs);
+            } else {
+                readable(-1);
+            }
+        }
+    }
+
+    bool eof() const { return atEnd && head == tail; }
+
+private:
+    int fd;
+    std::vector<char> buf;
+    size_t head = 0, tail = 0;  // unread bytes are [head, tail)
+    size_t scan = 0;            // [head, scan) is known to hold no newline
+    bool atEnd = false;
+
+    static std::string_view trim(std::string_view s) {
+        if (!s.empty() && s.back() == '\r') s.remove_suffix(1);
+        return s;
+    }
+
+    bool take(std::string_view& out) {
+        const char* nl = scan < tail ? (const char*)std::memchr(buf.data() + scan, '\n', tail - scan) : nullptr;
+        if (!nl) { scan = tail; return false; }
+        size_t at = (size_t)(nl - buf.data());
+        out = trim(std::string_view(buf.data() + head, at - head));
+        head = scan = at + 1;
+        return true;
+    }
+
+    // One read of whatever is available; grows the buffer for long lines.
+    void fill() {
+        if (head > 0) {
+            std::memmove(buf.data(), buf.data() + head, tail - head);
+            tail -= head; scan -= head; head = 0;
+        }
+        if (tail == buf.size()) buf.resize(buf.size() * 2);
+        while (true) {
+#ifdef _WIN32
+            int n = _read(fd, buf.data() + tail, (unsigned)(buf.size() - tail));
+#else
+            ssize_t n = ::read(fd, buf.data() + tail, buf.size() - tail);
+#endif
+            if (n > 0) { tail += (size_t)n; reads++; bytesRead += n; return; }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+            atEnd = true;
+            return;
+        }
+    }
+
+    // Whether a read() would return without blocking, waiting up to
+    // timeoutMs (-1: forever). End of input counts as readable.
+    bool readable(int timeoutMs) {
+#ifdef _WIN32
+        HANDLE h = (HANDLE)_get_osfhandle(fd);
+        switch (GetFileType(h)) {
+        case FILE_TYPE_PIPE:
+            for (DWORD waited = 0; ; waited += 1) {
+                DWORD avail = 0;
+                if (!PeekNamedPipe(h, nullptr, 0, nullptr, &avail, nullptr) || avail > 0) return true;
+                if (timeoutMs >= 0 && waited >= (DWORD)timeoutMs) return false;
+                Sleep(1);
+            }
+        case FILE_TYPE_CHAR:
+            // Console handles signal on any input event, so this may still
+            // block in _read() until Enter; good enough for interactive play.
+            return WaitForSingleObject(h, timeoutMs < 0 ? INFINITE : (DWORD)timeoutMs) == WAIT_OBJECT_0;
+        default:
+            return true;  // files never block
+        }
+#else
+        pollfd p{ fd, POLLIN, 0 };
+        int r;
+        do r = ::poll(&p, 1, timeoutMs); while (r < 0 && errno == EINTR);
+        return r != 0;
+#endif
+    }
+};
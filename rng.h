@@ -0,0 +1,177 @@
+// Small-state random number generators shared by game.cpp and rpg.cpp.
+//
+// Rand::Source<Engine> wraps any engine with range()/chance(). Bounded draws
+// use Lemire's multiply-shift method: unbiased, and in the common case one
+// 32-bit draw and one multiply, no division. Source<std::mt19937> keeps the
+// old uniform_int_distribution path, so builds with -DRNG_LEGACY_MT19937
+// reproduce the streams (and session logs) of earlier versions.
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <type_traits>
+
+namespace Rand {
+
+// 8 bytes of state. Also expands a single seed into larger states.
+class SplitMix64 {
+public:
+    using result_type = uint64_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~result_type(0); }
+
+    SplitMix64() : s(0) {}
+    explicit SplitMix64(uint64_t seed) : s(seed) {}
+    void seed(uint64_t seed) { s = seed; }
+
+    result_type operator()() {
+        uint64_t z = (s += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+private:
+    uint64_t s;
+};
+
+// PCG-XSH-RR: 16 bytes, 32-bit output, 2^63 selectable streams.
+class Pcg32 {
+public:
+    using result_type = uint32_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~result_type(0); }
+
+    explicit Pcg32(uint64_t seed = 0x853C49E6748FEA9BULL, uint64_t stream = 0xDA3E39CB94B95BDBULL) { this->seed(seed, stream); }
+
+    void seed(uint64_t seed, uint64_t stream = 0xDA3E39CB94B95BDBULL) {
+        state = 0;
+        inc = (stream << 1) | 1;
+        (*this)();
+        state += seed;
+        (*this)();
+    }
+
+    result_type operator()() {
+        uint64_t old = state;
+        state = old * 6364136223846793005ULL + inc;
+        uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+        uint32_t rot = (uint32_t)(old >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((0u - rot) & 31));
+    }
+
+private:
+    uint64_t state, inc;
+};
+
+// xoshiro256**: 32 bytes, 64-bit output.
+class Xoshiro256ss {
+public:
+    using result_type = uint64_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~result_type(0); }
+
+    explicit Xoshiro256ss(uint64_t seed = 1) { this->seed(seed); }
+
+    void seed(uint64_t seed) {
+        SplitMix64 sm(seed);
+        for (uint64_t& w : s) w = sm();
+    }
+
+    result_type operator()() {
+        uint64_t result = rotl(s[1] * 5, 7) * 9, t = s[1] << 17;
+        s[2] ^= s[0]; s[3] ^= s[1]; s[1] ^= s[2]; s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+private:
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+    uint64_t s[4];
+};
+
+// 32 random bits from any engine with a full-width 32- or 64-bit output.
+template <class G>
+inline uint32_t bits32(G& g) {
+    static_assert(G::min() == 0 && (G::max() == 0xFFFFFFFFu || G::max() == ~0ULL), "engine must produce full 32- or 64-bit words");
+    if constexpr (G::max() == 0xFFFFFFFFu) return (uint32_t)g();
+    else return (uint32_t)(g() >> 32);
+}
+
+// Unbiased integer in [0, n), n > 0 (Lemire, "Fast Random Integer
+// Generation in an Interval", 2019).
+template <class G>
+inline uint32_t below(G& g, uint32_t n) {
+    uint64_t m = (uint64_t)bits32(g) * n;
+    uint32_t low = (uint32_t)m;
+    if (low < n) {
+        uint32_t threshold = (0u - n) % n;
+        while (low < threshold) {
+            m = (uint64_t)bits32(g) * n;
+            low = (uint32_t)m;
+        }
+    }
+    return (uint32_t)(m >> 32);
+}
+
+// Uniform integer in [min, max]; the whole int range is allowed.
+template <class G>
+inline int range(G& g, int min, int max) {
+    uint32_t span = (uint32_t)((int64_t)max - min);
+    if (span == 0xFFFFFFFFu) return (int)bits32(g);
+    return (int)((int64_t)min + below(g, span + 1));
+}
+
+// True with probability percent/100.
+template <class G>
+inline bool chance(G& g, int percent) { return (int)below(g, 100) < percent; }
+
+template <class Engine>
+struct Source {
+    Engine gen;
+
+    Source() : gen(((uint64_t)std::random_device{}() << 32) | std::random_device{}()) {}
+    explicit Source(uint64_t seed) : gen(seed) {}
+
+    void seed(uint64_t s) { gen.seed(s); }
+
+    // Independent stream `stream` of `seed`, e.g. one per work chunk.
+    void seedStream(uint64_t seed, uint64_t stream) {
+        if constexpr (std::is_same_v<Engine, Pcg32>) gen.seed(seed, stream);
+        else gen.seed(SplitMix64(seed ^ (stream * 0xD1B54A32D192ED03ULL))());
+    }
+
+    int range(int min, int max) { return Rand::range(gen, min, max); }
+    bool chance(int percent) { return Rand::chance(gen, percent); }
+};
+
+// The pre-Lemire behaviour, draw for draw: 32-bit seeds, seed_seq streams
+// and a uniform_int_distribution per call.
+template <>
+struct Source<std::mt19937> {
+    std::mt19937 gen;
+
+    Source() : gen(std::random_device{}()) {}
+    explicit Source(uint64_t seed) : gen((unsigned)seed) {}
+
+    void seed(uint64_t s) { gen.seed((unsigned)s); }
+
+    void seedStream(uint64_t seed, uint64_t stream) {
+        std::seed_seq ss{ (unsigned)seed, (unsigned)stream };
+        gen.seed(ss);
+    }
+
+    int range(int min, int max) { return std::uniform_int_distribution<>(min, max)(gen); }
+    bool chance(int percent) { return range(1, 100) <= percent; }
+};
+
+#ifdef RNG_LEGACY_MT19937
+using Engine = std::mt19937;
+constexpr uint32_t streamVersion = 1;
+#else
+using Engine = Pcg32;
+constexpr uint32_t streamVersion = 2;  // bumps whenever seeded draws change
+#endif
+
+}
@@ -6,9 +6,313 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <cerrno>
+#include <string_view>
+#include <unordered_map>
+#include <iterator>
+#include <new>
+#include <memory_resource>
+#include <charconv>
+#include "rng.h"
+#include "input.h"
+#include "frame.h"
+#include "mapped_file.h"
+#include "session_log.h"
+#include <cstddef>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define RPG_TRACE_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define RPG_TRACE_TSC 1
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define RPG_SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RPG_SIMD_SSE2 1
+#endif
 #ifdef _WIN32
 #define NOMINMAX
 #include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#endif
+
+// Per-thread counts of global operator new/delete, for allocation reports.
+namespace AllocStats {
+    thread_local long long news = 0;
+    thread_local long long deletes = 0;
+}
+
+// The deletes stay out of line: inlined, GCC sees operator new paired with
+// free() and raises false -Wmismatched-new-delete warnings in the standard
+// containers.
+#if defined(__GNUC__) || defined(__clang__)
+#define RPG_NOINLINE __attribute__((noinline))
+#else
+#define RPG_NOINLINE
+#endif
+
+void* operator new(std::size_t n) {
+    AllocStats::news++;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+RPG_NOINLINE void operator delete(void* p) noexcept {
+    if (p) AllocStats::deletes++;
+    std::free(p);
+}
+RPG_NOINLINE void operator delete(void* p, std::size_t) noexcept {
+    if (p) AllocStats::deletes++;
+    std::free(p);
+}
+
+// Hot-path instrumentation. RPG_TRACE_SCOPE(Phase) times the enclosing block
+// into the calling thread's own counters and latency histogram, so scopes
+// never contend. Scopes cost one branch until profiling is switched on
+// (--profile, --trace); build with -DRPG_NO_TRACE to compile them out.
+namespace Trace {
+    enum Phase { Combat, PlayerTurn, EnemyTurn, ComputeDamage, GiveLoot, SaveGame, LoadGame, Shop, PhaseCount };
+    constexpr const char* phaseNames[PhaseCount] = {
+        "combat", "playerTurn", "enemyTurn", "computeDamage", "giveLoot", "saveGame", "loadGame", "shop"
+    };
+
+    // Log-linear buckets: exact below 8 ticks, then 8 per power of two, so a
+    // percentile read from the histogram is within 12.5% of the true value.
+    constexpr int subBits = 3;
+    constexpr int bucketCount = (64 - subBits + 1) << subBits;
+
+    inline int highBit(uint64_t v) {
+#if defined(_MSC_VER)
+        unsigned long i; _BitScanReverse64(&i, v); return (int)i;
+#else
+        return 63 - __builtin_clzll(v);
+#endif
+    }
+
+    inline int bucketOf(uint64_t t) {
+        if (t < (1u << subBits)) return (int)t;
+        int msb = highBit(t);
+        return ((msb - subBits + 1) << subBits) | (int)((t >> (msb - subBits)) & ((1u << subBits) - 1));
+    }
+
+    inline double bucketMid(int b) {
+        if (b < (1 << subBits)) return b;
+        int group = b >> subBits;
+        double lo = (double)((uint64_t)((1 << subBits) | (b & ((1 << subBits) - 1))) << (group - 1));
+        return lo + std::ldexp(1.0, group - 1) / 2;
+    }
+
+    inline uint64_t ticks() {
+#if defined(RPG_TRACE_TSC)
+        return __rdtsc();
+#else
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    // Written only by the owning thread; atomics let a report read them
+    // while the thread is still running.
+    struct PhaseStats {
+        std::atomic<uint64_t> calls{0}, ticks{0}, allocs{0};
+        std::array<std::atomic<uint64_t>, bucketCount> hist{};
+    };
+
+    struct Event { uint64_t start, duration; uint32_t phase; };
+
+    struct ThreadLog {
+        uint32_t tid = 0;
+        PhaseStats phases[PhaseCount];
+        std::vector<Event> events;  // --trace only; read once the thread is done
+        long long dropped = 0;
+    };
+
+    constexpr size_t maxEventsPerThread = size_t(1) << 22;
+
+    bool enabled = false;  // set before any worker thread starts
+    bool recordEvents = false;
+    uint64_t startTicks = 0;
+    std::chrono::steady_clock::time_point startTime;
+
+    std::mutex registryLock;
+    std::vector<ThreadLog*> registry;  // logs live until exit, past their threads
+    thread_local ThreadLog* local = nullptr;
+
+    inline void bump(std::atomic<uint64_t>& c, uint64_t v) {
+        c.store(c.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+    }
+
+    ThreadLog& self() {
+        if (!local) {
+            local = new ThreadLog;
+            std::lock_guard<std::mutex> lock(registryLock);
+            local->tid = (uint32_t)registry.size() + 1;
+            registry.push_back(local);
+        }
+        return *local;
+    }
+
+    void start(bool events) {
+        enabled = true;
+        recordEvents = events;
+        startTime = std::chrono::steady_clock::now();
+        startTicks = ticks();
+    }
+
+    void record(Phase phase, uint64_t t0, uint64_t dt, long long allocs) {
+        ThreadLog& log = self();
+        PhaseStats& s = log.phases[phase];
+        bump(s.calls, 1);
+        bump(s.ticks, dt);
+        bump(s.allocs, (uint64_t)allocs);
+        bump(s.hist[bucketOf(dt)], 1);
+        if (!recordEvents) return;
+        if (log.events.size() >= maxEventsPerThread) { log.dropped++; return; }
+        // Growing the trace buffer is not charged to the enclosing scopes.
+        long long news = AllocStats::news, deletes = AllocStats::deletes;
+        log.events.push_back({ t0, dt, (uint32_t)phase });
+        AllocStats::news = news; AllocStats::deletes = deletes;
+    }
+
+    class Scope {
+    public:
+        explicit Scope(Phase p) : phase(p), on(enabled) {
+            if (on) { allocs0 = AllocStats::news; t0 = ticks(); }
+        }
+        ~Scope() {
+            if (on) { uint64_t dt = ticks() - t0; record(phase, t0, dt, AllocStats::news - allocs0); }
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Phase phase;
+        bool on;
+        long long allocs0 = 0;
+        uint64_t t0 = 0;
+    };
+
+    double ticksPerNs() {
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count();
+        uint64_t dt = ticks() - startTicks;
+        return ns > 0 && dt > 0 ? dt / ns : 1.0;
+    }
+
+    // Per-phase calls, total time, mean/p50/p99 latency and allocations,
+    // merged across threads. Scopes nest, so totals are inclusive.
+    std::string summary() {
+        const double perNs = ticksPerNs();
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1);
+        out << std::left << std::setw(15) << "phase" << std::right << std::setw(12) << "calls" << std::setw(12) << "total ms"
+            << std::setw(10) << "mean ns" << std::setw(10) << "p50 ns" << std::setw(10) << "p99 ns" << std::setw(14) << "allocs/call" << "\n";
+        std::lock_guard<std::mutex> lock(registryLock);
+        for (int ph = 0; ph < PhaseCount; ++ph) {
+            uint64_t calls = 0, total = 0, allocs = 0;
+            std::vector<uint64_t> hist(bucketCount, 0);
+            for (const ThreadLog* log : registry) {
+                const PhaseStats& s = log->phases[ph];
+                calls += s.calls.load(std::memory_order_relaxed);
+                total += s.ticks.load(std::memory_order_relaxed);
+                allocs += s.allocs.load(std::memory_order_relaxed);
+                for (int b = 0; b < bucketCount; ++b) hist[b] += s.hist[b].load(std::memory_order_relaxed);
+            }
+            if (!calls) continue;
+            auto percentile = [&](double q) {
+                uint64_t rank = (uint64_t)std::ceil(q * calls), seen = 0;
+                for (int b = 0; b < bucketCount; ++b) if ((seen += hist[b]) >= rank) return bucketMid(b) / perNs;
+                return 0.0;
+            };
+            out << std::left << std::setw(15) << phaseNames[ph] << std::right << std::setw(12) << calls
+                << std::setw(12) << std::setprecision(3) << total / perNs / 1e6 << std::setprecision(1) << std::setw(10) << total / perNs / calls
+                << std::setw(10) << percentile(0.50) << std::setw(10) << percentile(0.99)
+                << std::setw(14) << std::setprecision(2) << (double)allocs / calls << std::setprecision(1) << "\n";
+        }
+        out << registry.size() << " thread(s) recorded\n";
+        return out.str();
+    }
+
+    // Chrome trace-event JSON (chrome://tracing, Perfetto): one complete
+    // ("X") event per scope, timestamps in microseconds since start().
+    // Call once every instrumented thread has finished.
+    bool writeChromeTrace(const std::string& path, long long& written) {
+        std::ofstream f(path, std::ios::binary | std::ios::trunc);
+        if (!f) return false;
+        const double perUs = ticksPerNs() * 1000;
+        std::lock_guard<std::mutex> lock(registryLock);
+        written = 0;
+        long long dropped = 0;
+        f << "{\"traceEvents\":[\n";
+        char line[256];
+        bool first = true;
+        for (const ThreadLog* log : registry) {
+            int n = std::snprintf(line, sizeof line, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}",
+                                  first ? "" : ",\n", log->tid, log->tid);
+            f.write(line, n);
+            first = false;
+            for (const Event& e : log->events) {
+                n = std::snprintf(line, sizeof line, ",\n{\"name\":\"%s\",\"cat\":\"rpg\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                                  phaseNames[e.phase], log->tid, (double)(int64_t)(e.start - startTicks) / perUs, e.duration / perUs);
+                f.write(line, n);
+            }
+            written += (long long)log->events.size();
+            dropped += log->dropped;
+        }
+        f << "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"droppedEvents\":" << dropped << "}}\n";
+        return (bool)f;
+    }
+
+    // Prints the summary (and writes the trace, if one was asked for) when
+    // main returns.
+    struct ExitReport {
+        std::string tracePath;
+        ~ExitReport() {
+            if (!enabled) return;
+            std::cout << "\n== Profile ==\n" << summary();
+            long long events = 0;
+            if (!tracePath.empty()) {
+                if (writeChromeTrace(tracePath, events)) std::cout << "Trace: " << events << " events written to " << tracePath << "\n";
+                else std::cout << "Trace: cannot write " << tracePath << "\n";
+            }
+            std::cout.flush();
+        }
+    };
+}
+
+#ifdef RPG_NO_TRACE
+#define RPG_TRACE_SCOPE(phase) ((void)0)
+#else
+#define RPG_TRACE_SCOPE(phase) Trace::Scope rpgTraceScope(Trace::phase)
 #endif
 
 // Simple color helpers (works on most modern Windows terminals)
@@ -23,12 +327,51 @@ namespace Color {
     const std::string bold = "\x1b[1m";
 }
 
-struct RNG {
-    std::mt19937 gen;
-    RNG() : gen(std::random_device{}()) {}
-    int range(int min, int max) { return std::uniform_int_distribution<>(min, max)(gen); }
-    bool chance(int percent) { return range(1, 100) <= percent; }
-} rng;
+Frame screen;
+
+// PCG32 with unbiased bounded draws (see rng.h); -DRNG_LEGACY_MT19937
+// brings back the mt19937 streams of older builds.
+using RNG = Rand::Source<Rand::Engine>;
+
+// One generator per thread so simulations can run on every core.
+thread_local RNG rng;
+
+struct Player;
+struct Enemy;
+
+// Headless mode for simulations: `quiet` suppresses combat output and, when a
+// policy is set, playerTurn asks it for the action instead of reading input.
+struct Headless {
+    bool quiet = false;
+    int (*policy)(const Player&, const Enemy&) = nullptr;
+    int lastTurns = 0;  // rounds fought in the most recent combat()
+};
+
+thread_local Headless headless;
+
+// Per-thread scratch memory for simulated encounters. Everything built on
+// resource() during one encounter is dropped in bulk by reset(); the buffer
+// itself is reused, so steady-state encounters never reach the global heap.
+// Overflow falls back to operator new, which shows up in --alloc-report.
+class EncounterArena {
+public:
+    std::pmr::memory_resource* resource() { return &pool; }
+    void reset() { pool.release(); }
+
+private:
+    alignas(std::max_align_t) std::byte buffer[64 * 1024];
+    std::pmr::monotonic_buffer_resource pool{ buffer, sizeof buffer };
+};
+
+thread_local EncounterArena encounterArena;
+
+// rpg's session logs (see session_log.h) follow the header with the content
+// pack hash: a replay also needs the content the session was recorded with.
+namespace SessionLog {
+    constexpr char magic[4] = { 'R', 'o', 'R', 'L' };
+}
+
+Input input(SessionLog::magic, sizeof(uint64_t));
 
 enum class ItemType { Weapon, Armor, Consumable };
 
@@ -40,35 +383,880 @@ struct Item {
     int price = 0;
 };
 
+// IDs index the active content (see Content). The named IDs are the core
+// entries game logic refers to; every content pack defines them first, so
+// they mean the same thing in the built-in catalog and in any pack.
+enum class ItemId : uint32_t { PotionSmall, PotionLarge, Sword, Greatsword, Leather, Plate, Count, None = UINT32_MAX };
+enum class EnemyId : uint32_t { Slime, Wolf, Bandit, Dragonling, Count };
+
+// Built-in game content, fixed at compile time. It is what the game runs on
+// when no content pack is loaded, and what `rpg --pack-export` writes out.
+namespace Catalog {
+    struct ItemDef { const char* name; ItemType type; int power; int healAmount; int price; };
+    struct EnemyDef { const char* name; int level, hp, attack, defense, xpReward, goldReward; size_t firstDrop, dropCount; };
+    struct DropDef { ItemId item; int weight; };  // ItemId::None: no drop
+    struct EncounterDef { EnemyId enemy; int weight; int minLevel, maxLevel; };  // player levels; 0 = unbounded
+    struct LocationDef { const char* name; size_t firstEncounter, encounterCount; };
+
+    constexpr ItemDef items[] = {
+        { "Small Potion",  ItemType::Consumable, 0, 15, 10 },
+        { "Large Potion",  ItemType::Consumable, 0, 35, 30 },
+        { "Iron Sword",    ItemType::Weapon,     4,  0, 40 },
+        { "Greatsword",    ItemType::Weapon,     8,  0, 100 },
+        { "Leather Armor", ItemType::Armor,      3,  0, 35 },
+        { "Plate Armor",   ItemType::Armor,      7,  0, 120 },
+    };
+    constexpr EnemyDef enemies[] = {
+        { "Green Slime", 1, 20,  4, 1, 10,  8, 0, 2 },
+        { "Wild Wolf",   2, 28,  6, 2, 16, 15, 2, 2 },
+        { "Bandit",      3, 36,  8, 3, 25, 25, 4, 2 },
+        { "Dragonling",  5, 55, 12, 6, 45, 60, 6, 2 },
+    };
+    constexpr DropDef drops[] = {
+        { ItemId::PotionSmall, 1 }, { ItemId::None, 1 },
+        { ItemId::PotionSmall, 1 }, { ItemId::None, 1 },
+        { ItemId::PotionLarge, 1 }, { ItemId::None, 1 },
+        { ItemId::Greatsword, 1 }, { ItemId::None, 1 },
+    };
+    // Content pack keys of the core IDs, in ID order.
+    constexpr const char* itemKeys[] = { "potion_small", "potion_large", "sword", "greatsword", "leather", "plate" };
+    constexpr const char* enemyKeys[] = { "slime", "wolf", "bandit", "dragonling" };
+    constexpr EncounterDef encounters[] = {
+        { EnemyId::Slime, 1, 0, 0 }, { EnemyId::Wolf, 1, 0, 0 },
+        { EnemyId::Bandit, 1, 0, 0 }, { EnemyId::Wolf, 1, 0, 0 },
+        { EnemyId::Dragonling, 1, 0, 0 }, { EnemyId::Bandit, 1, 0, 0 },
+    };
+    constexpr LocationDef locations[] = {
+        { "ທົ່ງຫຍ້າ", 0, 2 },
+        { "ທາງໂຈນ", 2, 2 },
+        { "ຖ້ຳພູໄຟ", 4, 2 },
+    };
+    constexpr ItemId shopStock[] = { ItemId::PotionSmall, ItemId::PotionLarge, ItemId::Sword, ItemId::Leather, ItemId::Greatsword, ItemId::Plate };
+    static_assert(std::size(items) == (size_t)ItemId::Count && std::size(enemies) == (size_t)EnemyId::Count, "catalog out of sync with IDs");
+    static_assert(std::size(itemKeys) == std::size(items) && std::size(enemyKeys) == std::size(enemies), "every core ID needs a pack key");
+}
+
+// Content packs. The source is text, one `|`-separated record per line (see
+// compileText); it compiles to a binary image that is mapped and read in place:
+//   Header | ItemRecord[] | EnemyRecord[] | DropRecord[] | LocationRecord[] | EncounterRecord[] | uint32 shop[] | strings
+// Strings are NUL-terminated and referenced by offset. Opening an image only
+// checks the header and section sizes, so load time does not grow with the
+// pack; bad offsets and IDs are caught when a record is read.
+namespace ContentPack {
+    constexpr char magic[4] = { 'R', 'o', 'R', 'C' };
+    constexpr uint32_t version = 2;  // 2: drop tables, level-ranged encounters
+
+    struct Header { char magic[4]; uint32_t version, itemCount, enemyCount, dropCount, locationCount, encounterCount, shopCount, stringBytes; };
+    struct ItemRecord { uint32_t name; int32_t type, power, healAmount, price; };
+    struct EnemyRecord { uint32_t name; int32_t level, hp, attack, defense, xpReward, goldReward; uint32_t firstDrop, dropCount; };
+    struct DropRecord { uint32_t item, weight; };  // item (uint32_t)ItemId::None: no drop
+    struct LocationRecord { uint32_t name, firstEncounter, encounterCount; };
+    struct EncounterRecord { uint32_t enemy, weight; int32_t minLevel, maxLevel; };
+    static_assert(sizeof(Header) == 36 && sizeof(ItemRecord) == 20 && sizeof(EnemyRecord) == 36 && sizeof(DropRecord) == 8
+                  && sizeof(LocationRecord) == 12 && sizeof(EncounterRecord) == 16, "pack records must stay unpadded");
+
+    // Zero-copy accessor over a pack image.
+    class View {
+    public:
+        bool open(const char* data, size_t size) {
+            if (size < sizeof(Header)) return false;
+            const Header* h = reinterpret_cast<const Header*>(data);
+            if (std::memcmp(h->magic, magic, 4) != 0 || h->version != version) return false;
+            uint64_t need = sizeof(Header) + (uint64_t)h->itemCount * sizeof(ItemRecord) + (uint64_t)h->enemyCount * sizeof(EnemyRecord)
+                + (uint64_t)h->dropCount * sizeof(DropRecord) + (uint64_t)h->locationCount * sizeof(LocationRecord) + (uint64_t)h->encounterCount * sizeof(EncounterRecord)
+                + (uint64_t)h->shopCount * sizeof(uint32_t) + h->stringBytes;
+            if (need != size || h->stringBytes == 0 || data[size - 1] != '\0') return false;
+            if (h->itemCount < (uint32_t)ItemId::Count || h->enemyCount < (uint32_t)EnemyId::Count || h->locationCount == 0) return false;
+            hdr = h;
+            items = reinterpret_cast<const ItemRecord*>(data + sizeof(Header));
+            enemies = reinterpret_cast<const EnemyRecord*>(items + h->itemCount);
+            drops = reinterpret_cast<const DropRecord*>(enemies + h->enemyCount);
+            locations = reinterpret_cast<const LocationRecord*>(drops + h->dropCount);
+            encounters = reinterpret_cast<const EncounterRecord*>(locations + h->locationCount);
+            shop = reinterpret_cast<const uint32_t*>(encounters + h->encounterCount);
+            strings = reinterpret_cast<const char*>(shop + h->shopCount);
+            return true;
+        }
+
+        size_t itemCount() const { return hdr->itemCount; }
+        size_t enemyCount() const { return hdr->enemyCount; }
+        size_t dropCount() const { return hdr->dropCount; }
+        size_t locationCount() const { return hdr->locationCount; }
+        size_t encounterCount() const { return hdr->encounterCount; }
+        size_t shopSize() const { return hdr->shopCount; }
+
+        // Always a valid C string; out-of-range offsets read as "".
+        const char* str(uint32_t offset) const { return offset < hdr->stringBytes ? strings + offset : ""; }
+
+        // Out-of-range IDs read as the first entry.
+        Catalog::ItemDef item(ItemId id) const {
+            const ItemRecord& r = items[(uint32_t)id < hdr->itemCount ? (uint32_t)id : 0];
+            ItemType type = r.type >= 0 && r.type <= (int)ItemType::Consumable ? (ItemType)r.type : ItemType::Consumable;
+            return { str(r.name), type, r.power, r.healAmount, r.price };
+        }
+        Catalog::EnemyDef enemy(EnemyId id) const {
+            const EnemyRecord& r = enemies[(uint32_t)id < hdr->enemyCount ? (uint32_t)id : 0];
+            return { str(r.name), r.level, r.hp, r.attack, r.defense, r.xpReward, r.goldReward, r.firstDrop, r.dropCount };
+        }
+        const DropRecord* drop(size_t i) const { return drops + i; }
+        ItemId shopItem(size_t i) const { return shop[i] < hdr->itemCount ? (ItemId)shop[i] : ItemId::PotionSmall; }
+        const LocationRecord& location(size_t i) const { return locations[i]; }
+        const EncounterRecord* encounter(size_t i) const { return encounters + i; }
+
+    private:
+        const Header* hdr = nullptr;
+        const ItemRecord* items = nullptr;
+        const EnemyRecord* enemies = nullptr;
+        const DropRecord* drops = nullptr;
+        const LocationRecord* locations = nullptr;
+        const EncounterRecord* encounters = nullptr;
+        const uint32_t* shop = nullptr;
+        const char* strings = nullptr;
+    };
+
+    // Assembles a pack image, storing each distinct string once.
+    class Builder {
+    public:
+        std::vector<ItemRecord> items;
+        std::vector<EnemyRecord> enemies;
+        std::vector<DropRecord> drops;
+        std::vector<LocationRecord> locations;
+        std::vector<EncounterRecord> encounters;
+        std::vector<uint32_t> shop;
+
+        uint32_t str(std::string_view s) {
+            auto found = index.find(std::string(s));
+            if (found != index.end()) return found->second;
+            uint32_t offset = (uint32_t)table.size();
+            table.append(s.data(), s.size());
+            table.push_back('\0');
+            index.emplace(std::string(s), offset);
+            return offset;
+        }
+
+        // r's drop range is filled in from list.
+        void addEnemy(EnemyRecord r, const std::vector<DropRecord>& list) {
+            r.firstDrop = (uint32_t)drops.size();
+            r.dropCount = (uint32_t)list.size();
+            enemies.push_back(r);
+            drops.insert(drops.end(), list.begin(), list.end());
+        }
+
+        void addLocation(std::string_view name, const std::vector<EncounterRecord>& list) {
+            locations.push_back({ str(name), (uint32_t)encounters.size(), (uint32_t)list.size() });
+            encounters.insert(encounters.end(), list.begin(), list.end());
+        }
+
+        std::string image() const {
+            Header h{};
+            std::memcpy(h.magic, magic, 4);
+            h.version = version;
+            h.itemCount = (uint32_t)items.size(); h.enemyCount = (uint32_t)enemies.size(); h.dropCount = (uint32_t)drops.size();
+            h.locationCount = (uint32_t)locations.size(); h.encounterCount = (uint32_t)encounters.size();
+            h.shopCount = (uint32_t)shop.size(); h.stringBytes = (uint32_t)table.size();
+            std::string out;
+            auto put = [&](const void* p, size_t n) { out.append((const char*)p, n); };
+            put(&h, sizeof h);
+            put(items.data(), items.size() * sizeof(ItemRecord));
+            put(enemies.data(), enemies.size() * sizeof(EnemyRecord));
+            put(drops.data(), drops.size() * sizeof(DropRecord));
+            put(locations.data(), locations.size() * sizeof(LocationRecord));
+            put(encounters.data(), encounters.size() * sizeof(EncounterRecord));
+            put(shop.data(), shop.size() * sizeof(uint32_t));
+            put(table.data(), table.size());
+            return out;
+        }
+
+    private:
+        std::string table = std::string(1, '\0');  // offset 0 is ""
+        std::unordered_map<std::string, uint32_t> index;
+    };
+
+    std::string builtinImage() {
+        Builder b;
+        for (const auto& d : Catalog::items) b.items.push_back({ b.str(d.name), (int32_t)d.type, d.power, d.healAmount, d.price });
+        for (const auto& d : Catalog::enemies) {
+            std::vector<DropRecord> list;
+            for (size_t i = 0; i < d.dropCount; ++i) {
+                const auto& drop = Catalog::drops[d.firstDrop + i];
+                list.push_back({ (uint32_t)drop.item, (uint32_t)drop.weight });
+            }
+            b.addEnemy({ b.str(d.name), d.level, d.hp, d.attack, d.defense, d.xpReward, d.goldReward, 0, 0 }, list);
+        }
+        for (const auto& l : Catalog::locations) {
+            std::vector<EncounterRecord> list;
+            for (size_t i = 0; i < l.encounterCount; ++i) {
+                const auto& e = Catalog::encounters[l.firstEncounter + i];
+                list.push_back({ (uint32_t)e.enemy, (uint32_t)e.weight, e.minLevel, e.maxLevel });
+            }
+            b.addLocation(l.name, list);
+        }
+        for (ItemId id : Catalog::shopStock) b.shop.push_back((uint32_t)id);
+        return b.image();
+    }
+
+    const char* typeName(ItemType t) { return t == ItemType::Weapon ? "weapon" : t == ItemType::Armor ? "armor" : "consumable"; }
+
+    // Compiles a text pack to a binary image. One record per line, fields
+    // separated by '|', lines starting with '#' ignored:
+    //   item|key|name|weapon,armor,consumable|power|heal|price
+    //   enemy|key|name|level|hp|attack|defense|xp|gold|drops
+    //   location|name|encounters
+    //   shop|item key
+    // drops is `item key:weight,...` with `-` as the no-drop item, or just
+    // `-` for none. encounters is `enemy key:weight@min-max,...`, where the
+    // optional level range limits the player levels that can meet the enemy
+    // (`@3-` and `@-5` leave one end open). Weights default to 1.
+    // Keys only name entries inside the pack. The core keys (Catalog::itemKeys,
+    // Catalog::enemyKeys) are required and take the core IDs; all other
+    // entries follow in file order.
+    bool compileText(std::string_view text, std::string& image, std::string& error) {
+        struct Line { size_t number; std::vector<std::string_view> f; };
+        std::vector<Line> itemLines, enemyLines, locationLines, shopLines;
+        auto fail = [&](size_t number, const std::string& what) { error = "line " + std::to_string(number) + ": " + what; return false; };
+
+        size_t number = 0;
+        for (size_t pos = 0; pos < text.size();) {
+            size_t end = text.find('\n', pos);
+            if (end == std::string_view::npos) end = text.size();
+            std::string_view line = text.substr(pos, end - pos);
+            pos = end + 1;
+            number++;
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (line.empty() || line[0] == '#') continue;
+            Line l{ number, {} };
+            for (size_t start = 0;;) {
+                size_t bar = line.find('|', start);
+                l.f.push_back(line.substr(start, bar == std::string_view::npos ? std::string_view::npos : bar - start));
+                if (bar == std::string_view::npos) break;
+                start = bar + 1;
+            }
+            const std::string_view kind = l.f[0];
+            size_t want = kind == "item" ? 7 : kind == "enemy" ? 10 : kind == "location" ? 3 : kind == "shop" ? 2 : 0;
+            if (!want) return fail(number, "unknown record '" + std::string(kind) + "'");
+            if (l.f.size() != want) return fail(number, std::string(kind) + " needs " + std::to_string(want) + " fields");
+            (kind == "item" ? itemLines : kind == "enemy" ? enemyLines : kind == "location" ? locationLines : shopLines).push_back(std::move(l));
+        }
+
+        // Core keys take IDs 0..Count-1, everything else follows in file order.
+        auto order = [&](std::vector<Line>& lines, const char* const* core, size_t coreCount, const char* what,
+                         std::vector<const Line*>& out, std::unordered_map<std::string_view, uint32_t>& ids) {
+            std::unordered_map<std::string_view, const Line*> byKey;
+            for (const auto& l : lines)
+                if (!byKey.emplace(l.f[1], &l).second) return fail(l.number, std::string("duplicate ") + what + " key '" + std::string(l.f[1]) + "'");
+            for (size_t i = 0; i < coreCount; ++i) {
+                auto found = byKey.find(core[i]);
+                if (found == byKey.end()) { error = std::string("missing core ") + what + " '" + core[i] + "'"; return false; }
+                out.push_back(found->second);
+            }
+            for (const auto& l : lines)
+                if (std::find_if(core, core + coreCount, [&](const char* k) { return l.f[1] == k; }) == core + coreCount) out.push_back(&l);
+            for (size_t i = 0; i < out.size(); ++i) ids.emplace(out[i]->f[1], (uint32_t)i);
+            return true;
+        };
+        std::vector<const Line*> itemOrder, enemyOrder;
+        std::unordered_map<std::string_view, uint32_t> itemIds, enemyIds;
+        if (!order(itemLines, Catalog::itemKeys, std::size(Catalog::itemKeys), "item", itemOrder, itemIds)) return false;
+        if (!order(enemyLines, Catalog::enemyKeys, std::size(Catalog::enemyKeys), "enemy", enemyOrder, enemyIds)) return false;
+
+        auto num = [](std::string_view s, int32_t& out) {
+            auto r = std::from_chars(s.data(), s.data() + s.size(), out);
+            return r.ec == std::errc() && r.ptr == s.data() + s.size();
+        };
+        // Splits a `key:weight@min-max,...` list; calls add(key, weight, min, max).
+        auto weighted = [&](const Line& l, std::string_view list, auto&& add) {
+            int64_t total = 0;
+            while (!list.empty()) {
+                size_t comma = list.find(',');
+                std::string_view entry = list.substr(0, comma);
+                list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+                int32_t weight = 1, minLevel = 0, maxLevel = 0;
+                size_t at = entry.find('@');
+                if (at != std::string_view::npos) {
+                    std::string_view range = entry.substr(at + 1);
+                    size_t dash = range.find('-');
+                    if (dash == std::string_view::npos || (dash > 0 && !num(range.substr(0, dash), minLevel))
+                        || (dash + 1 < range.size() && !num(range.substr(dash + 1), maxLevel)) || minLevel < 0 || maxLevel < 0
+                        || (maxLevel && maxLevel < minLevel))
+                        return fail(l.number, "bad level range in '" + std::string(entry) + "'");
+                    entry = entry.substr(0, at);
+                }
+                size_t colon = entry.find(':');
+                if (colon != std::string_view::npos && (!num(entry.substr(colon + 1), weight) || weight < 1))
+                    return fail(l.number, "bad weight in '" + std::string(entry) + "'");
+                total += weight;
+                if (total > INT32_MAX) return fail(l.number, "weights too large");
+                if (!add(entry.substr(0, colon), (uint32_t)weight, minLevel, maxLevel)) return false;
+            }
+            return true;
+        };
+        Builder b;
+        for (const Line* l : itemOrder) {
+            ItemRecord r{ b.str(l->f[2]), 0, 0, 0, 0 };
+            const std::string_view type = l->f[3];
+            if (type == "weapon") r.type = (int32_t)ItemType::Weapon;
+            else if (type == "armor") r.type = (int32_t)ItemType::Armor;
+            else if (type == "consumable") r.type = (int32_t)ItemType::Consumable;
+            else return fail(l->number, "unknown item type '" + std::string(type) + "'");
+            if (!num(l->f[4], r.power) || !num(l->f[5], r.healAmount) || !num(l->f[6], r.price)) return fail(l->number, "bad number");
+            b.items.push_back(r);
+        }
+        for (const Line* l : enemyOrder) {
+            EnemyRecord r{ b.str(l->f[2]), 0, 0, 0, 0, 0, 0, 0, 0 };
+            if (!num(l->f[3], r.level) || !num(l->f[4], r.hp) || !num(l->f[5], r.attack) || !num(l->f[6], r.defense)
+                || !num(l->f[7], r.xpReward) || !num(l->f[8], r.goldReward)) return fail(l->number, "bad number");
+            if (r.level < 1 || r.hp < 1) return fail(l->number, "enemy level and hp must be at least 1");
+            std::vector<DropRecord> list;
+            bool ok = l->f[9] == "-" || weighted(*l, l->f[9], [&](std::string_view key, uint32_t weight, int32_t minLevel, int32_t maxLevel) {
+                if (minLevel || maxLevel) return fail(l->number, "drops take no level range");
+                if (key == "-") { list.push_back({ (uint32_t)ItemId::None, weight }); return true; }
+                auto found = itemIds.find(key);
+                if (found == itemIds.end()) return fail(l->number, "unknown item '" + std::string(key) + "'");
+                list.push_back({ found->second, weight });
+                return true;
+            });
+            if (!ok) return false;
+            b.addEnemy(r, list);
+        }
+        for (const auto& l : locationLines) {
+            std::vector<EncounterRecord> list;
+            bool ok = weighted(l, l.f[2], [&](std::string_view key, uint32_t weight, int32_t minLevel, int32_t maxLevel) {
+                auto found = enemyIds.find(key);
+                if (found == enemyIds.end()) return fail(l.number, "unknown enemy '" + std::string(key) + "'");
+                list.push_back({ found->second, weight, minLevel, maxLevel });
+                return true;
+            });
+            if (!ok) return false;
+            if (list.empty()) return fail(l.number, "location needs at least one encounter");
+            b.addLocation(l.f[1], list);
+        }
+        if (b.locations.empty()) { error = "pack needs at least one location"; return false; }
+        for (const auto& l : shopLines) {
+            auto found = itemIds.find(l.f[1]);
+            if (found == itemIds.end()) return fail(l.number, "unknown item '" + std::string(l.f[1]) + "'");
+            b.shop.push_back(found->second);
+        }
+        image = b.image();
+        return true;
+    }
+
+    // Text source for a pack. Non-core entries get generated keys.
+    std::string exportText(const View& v) {
+        auto itemKey = [](size_t i) { return i < (size_t)ItemId::Count ? std::string(Catalog::itemKeys[i]) : "item" + std::to_string(i); };
+        auto enemyKey = [](size_t i) { return i < (size_t)EnemyId::Count ? std::string(Catalog::enemyKeys[i]) : "enemy" + std::to_string(i); };
+        std::string out = "# Rift of Realms content pack (compile with: rpg --pack-compile <this file> content.bin)\n";
+        out += "\n# item|key|name|weapon,armor,consumable|power|heal|price\n";
+        for (size_t i = 0; i < v.itemCount(); ++i) {
+            const auto d = v.item((ItemId)i);
+            out += "item|" + itemKey(i) + "|" + d.name + "|" + typeName(d.type) + "|" + std::to_string(d.power) + "|"
+                 + std::to_string(d.healAmount) + "|" + std::to_string(d.price) + "\n";
+        }
+        out += "\n# enemy|key|name|level|hp|attack|defense|xp|gold|drops (item key:weight,..., - = no drop)\n";
+        for (size_t i = 0; i < v.enemyCount(); ++i) {
+            const auto d = v.enemy((EnemyId)i);
+            out += "enemy|" + enemyKey(i) + "|" + d.name + "|" + std::to_string(d.level) + "|" + std::to_string(d.hp) + "|"
+                 + std::to_string(d.attack) + "|" + std::to_string(d.defense) + "|" + std::to_string(d.xpReward) + "|"
+                 + std::to_string(d.goldReward) + "|";
+            if (d.dropCount == 0 || (uint64_t)d.firstDrop + d.dropCount > v.dropCount()) out += "-";
+            for (size_t e = 0; e < d.dropCount && (uint64_t)d.firstDrop + d.dropCount <= v.dropCount(); ++e) {
+                const auto* drop = v.drop(d.firstDrop + e);
+                out += (e ? "," : "") + (drop->item < v.itemCount() ? itemKey(drop->item) : std::string("-")) + ":" + std::to_string(drop->weight);
+            }
+            out += "\n";
+        }
+        out += "\n# location|name|enemy key:weight@min level-max level,...\n";
+        for (size_t i = 0; i < v.locationCount(); ++i) {
+            const auto& l = v.location(i);
+            out += "location|" + std::string(v.str(l.name)) + "|";
+            for (uint32_t e = 0; e < l.encounterCount && (size_t)l.firstEncounter + e < v.encounterCount(); ++e) {
+                const auto* enc = v.encounter(l.firstEncounter + e);
+                out += (e ? "," : "") + enemyKey(enc->enemy) + ":" + std::to_string(enc->weight);
+                if (enc->minLevel || enc->maxLevel)
+                    out += "@" + (enc->minLevel ? std::to_string(enc->minLevel) : "") + "-" + (enc->maxLevel ? std::to_string(enc->maxLevel) : "");
+            }
+            out += "\n";
+        }
+        out += "\n# shop|item key\n";
+        for (size_t i = 0; i < v.shopSize(); ++i) out += "shop|" + itemKey((size_t)v.shopItem(i)) + "\n";
+        return out;
+    }
+
+    // A copy of a valid image with new enemy stats ({ hp, attack, defense,
+    // xp, gold } per enemy) and item prices. Layout and strings are unchanged.
+    std::string restat(std::string_view image, const std::vector<std::array<int32_t, 5>>& enemies, const std::vector<int32_t>& prices) {
+        std::string out(image);
+        Header h;
+        std::memcpy(&h, out.data(), sizeof h);
+        char* at = out.data() + sizeof(Header);
+        for (size_t i = 0; i < h.itemCount; ++i, at += sizeof(ItemRecord)) {
+            ItemRecord r;
+            std::memcpy(&r, at, sizeof r);
+            if (i < prices.size()) r.price = prices[i];
+            std::memcpy(at, &r, sizeof r);
+        }
+        for (size_t i = 0; i < h.enemyCount; ++i, at += sizeof(EnemyRecord)) {
+            EnemyRecord r;
+            std::memcpy(&r, at, sizeof r);
+            if (i < enemies.size()) { const auto& e = enemies[i]; r.hp = e[0]; r.attack = e[1]; r.defense = e[2]; r.xpReward = e[3]; r.goldReward = e[4]; }
+            std::memcpy(at, &r, sizeof r);
+        }
+        return out;
+    }
+
+    // Version 1 packs: one optional loot item per enemy, dropped half the
+    // time, and encounters with no level range. upgradeV1 rebuilds such an
+    // image in the current layout, so old content.bin files keep working.
+    namespace V1 {
+        struct Header { char magic[4]; uint32_t version, itemCount, enemyCount, locationCount, encounterCount, shopCount, stringBytes; };
+        struct EnemyRecord { uint32_t name; int32_t level, hp, attack, defense, xpReward, goldReward; uint32_t loot; };
+        struct LocationRecord { uint32_t name, firstEncounter, encounterCount, totalWeight; };
+        struct EncounterRecord { uint32_t enemy, weight; };
+        static_assert(sizeof(Header) == 32 && sizeof(EnemyRecord) == 32 && sizeof(LocationRecord) == 16 && sizeof(EncounterRecord) == 8,
+                      "pack records must stay unpadded");
+    }
+
+    bool upgradeV1(const char* data, size_t size, std::string& image) {
+        V1::Header h;
+        if (size < sizeof h) return false;
+        std::memcpy(&h, data, sizeof h);
+        if (std::memcmp(h.magic, magic, 4) != 0 || h.version != 1) return false;
+        uint64_t need = sizeof h + (uint64_t)h.itemCount * sizeof(ItemRecord) + (uint64_t)h.enemyCount * sizeof(V1::EnemyRecord)
+            + (uint64_t)h.locationCount * sizeof(V1::LocationRecord) + (uint64_t)h.encounterCount * sizeof(V1::EncounterRecord)
+            + (uint64_t)h.shopCount * sizeof(uint32_t) + h.stringBytes;
+        if (need != size || h.stringBytes == 0 || data[size - 1] != '\0') return false;
+        const char* at = data + sizeof h;
+        const char* strings = data + size - h.stringBytes;
+        auto next = [&](auto& r) { std::memcpy(&r, at, sizeof r); at += sizeof r; };
+        auto str = [&](uint32_t offset) { return std::string_view(offset < h.stringBytes ? strings + offset : ""); };
+
+        Builder b;
+        for (uint32_t i = 0; i < h.itemCount; ++i) {
+            ItemRecord r; next(r);
+            r.name = b.str(str(r.name));
+            b.items.push_back(r);
+        }
+        for (uint32_t i = 0; i < h.enemyCount; ++i) {
+            V1::EnemyRecord r; next(r);
+            std::vector<DropRecord> list;
+            if (r.loot < h.itemCount) list = { { r.loot, 1 }, { (uint32_t)ItemId::None, 1 } };
+            b.addEnemy({ b.str(str(r.name)), r.level, r.hp, r.attack, r.defense, r.xpReward, r.goldReward, 0, 0 }, list);
+        }
+        std::vector<V1::LocationRecord> locations(h.locationCount);
+        for (auto& r : locations) next(r);
+        std::vector<EncounterRecord> encounters;
+        for (uint32_t i = 0; i < h.encounterCount; ++i) {
+            V1::EncounterRecord r; next(r);
+            encounters.push_back({ r.enemy, r.weight, 0, 0 });
+        }
+        for (const auto& l : locations) {
+            // A bad encounter range becomes a location with no encounters.
+            bool ok = (uint64_t)l.firstEncounter + l.encounterCount <= encounters.size();
+            b.addLocation(str(l.name), ok ? std::vector<EncounterRecord>(encounters.begin() + l.firstEncounter, encounters.begin() + l.firstEncounter + l.encounterCount)
+                                          : std::vector<EncounterRecord>());
+        }
+        for (uint32_t i = 0; i < h.shopCount; ++i) { uint32_t id; next(id); b.shop.push_back(id); }
+        image = b.image();
+        return true;
+    }
+
+    // A pack in memory: a binary file mapped in place, or a text file (or
+    // the built-in catalog) compiled to an owned image.
+    struct Loaded {
+        std::unique_ptr<MappedFile> file;
+        std::string image;
+        View view;
+
+        Loaded() = default;
+        Loaded(Loaded&& o) noexcept : file(std::move(o.file)), image(std::move(o.image)) { open(); }
+        Loaded& operator=(Loaded&& o) noexcept { file = std::move(o.file); image = std::move(o.image); open(); return *this; }
+
+        bool open() { return file ? view.open(file->data(), file->size()) : view.open(image.data(), image.size()); }
+        std::string_view bytes() const { return file ? std::string_view(file->data(), file->size()) : std::string_view(image); }
+    };
+
+    Loaded builtin() {
+        Loaded l;
+        l.image = builtinImage();
+        l.open();
+        return l;
+    }
+
+    // Maps a binary pack, or compiles a text one. A version 1 binary pack
+    // is upgraded in memory.
+    bool load(const std::string& path, Loaded& out, std::string& error) {
+        Loaded next;
+        next.file = std::make_unique<MappedFile>(path);
+        if (!next.file->ok()) { error = "cannot read " + path; return false; }
+        if (next.file->size() < 4 || std::memcmp(next.file->data(), magic, 4) != 0) {
+            if (!compileText(std::string_view(next.file->data(), next.file->size()), next.image, error)) { error = path + ": " + error; return false; }
+            next.file.reset();
+        } else if (upgradeV1(next.file->data(), next.file->size(), next.image)) {
+            next.file.reset();
+        }
+        if (!next.open()) {
+            error = path + ": not a valid version " + std::to_string(version) + " content pack (recompile it with --pack-compile)";
+            return false;
+        }
+        out = std::move(next);
+        return true;
+    }
+}
+
+// The content the game runs on: the built-in catalog unless main() loads
+// a pack (--content, or content.bin / content.txt next to the game).
+namespace Content {
+    ContentPack::Loaded active = ContentPack::builtin();
+    uint64_t generation = 0;  // bumped on every load, so derived tables know to rebuild
+
+    const ContentPack::View& pack() { return active.view; }
+    Catalog::ItemDef item(ItemId id) { return active.view.item(id); }
+    Catalog::EnemyDef enemy(EnemyId id) { return active.view.enemy(id); }
+    Item makeItem(ItemId id) { const auto d = item(id); return Item{ d.name, d.type, d.power, d.healAmount, d.price }; }
+
+    bool load(const std::string& path, std::string& error) {
+        if (!ContentPack::load(path, active, error)) return false;
+        generation++;
+        return true;
+    }
+}
+
+// Weighted sampling in O(1) with Vose's alias method. Each of the n columns
+// holds its own outcome with probability threshold / 2^32 and its alias
+// otherwise; build() splits the weights into columns exactly in integer
+// arithmetic, so the only bias is the column pick (n / 2^32 at most).
+class AliasTable {
+public:
+    // Zero total weight, or more than 2^32, gives an empty table.
+    void build(const std::vector<uint32_t>& weights) {
+        size_t n = weights.size();
+        uint64_t total = 0;
+        for (uint32_t w : weights) total += w;
+        if (total == 0 || total > UINT32_MAX) n = 0;
+        threshold.assign(n, 0);
+        alias.resize(n);
+        if (n == 0) return;
+
+        static thread_local std::vector<uint64_t> scaled;
+        static thread_local std::vector<uint32_t> small, large;
+        scaled.resize(n); small.clear(); large.clear();
+        for (size_t i = 0; i < n; ++i) {
+            scaled[i] = (uint64_t)weights[i] * n;  // the average column holds exactly `total`
+            (scaled[i] < total ? small : large).push_back((uint32_t)i);
+        }
+        while (!small.empty() && !large.empty()) {
+            uint32_t s = small.back(); small.pop_back();
+            uint32_t l = large.back();
+            threshold[s] = (uint32_t)((scaled[s] << 32) / total);
+            alias[s] = l;
+            scaled[l] -= total - scaled[s];
+            if (scaled[l] < total) { large.pop_back(); small.push_back(l); }
+        }
+        // What remains is exactly full: always its own outcome.
+        for (uint32_t i : large) alias[i] = i;
+        for (uint32_t i : small) alias[i] = i;
+    }
+
+    size_t size() const { return alias.size(); }
+    bool empty() const { return alias.empty(); }
+
+    // Index of the sampled weight; the table must not be empty.
+    uint32_t sample(RNG& r) const {
+        uint32_t col = (uint32_t)(((uint64_t)Rand::bits32(r.gen) * alias.size()) >> 32);
+        return Rand::bits32(r.gen) < threshold[col] ? col : alias[col];
+    }
+
+private:
+    std::vector<uint32_t> threshold;
+    std::vector<uint32_t> alias;
+};
+
+// Alias tables over the active content's encounter and drop weights. They
+// are built on first use, per thread, and rebuilt only when the weights
+// change: when content is reloaded or, for encounters, when the player's
+// level crosses into or out of an encounter's level range.
+namespace Tables {
+    struct Encounters {
+        AliasTable alias;
+        std::vector<EnemyId> enemies;    // alias index -> enemy
+        std::vector<uint32_t> weights;   // alias index -> encounter weight
+        int minLevel = 1, maxLevel = 0;  // player levels this table is valid for
+
+        bool empty() const { return alias.empty(); }
+        EnemyId sample() const { return enemies[alias.sample(rng)]; }
+    };
+
+    struct Drops {
+        AliasTable alias;
+        std::vector<ItemId> items;  // alias index -> item, ItemId::None for no drop
+    };
+
+    struct Cache {
+        uint64_t generation = 0;
+        std::unordered_map<uint32_t, Encounters> encounters;  // by location
+        std::unordered_map<uint32_t, Drops> drops;            // by enemy
+        std::vector<uint32_t> weights;                        // drop table build scratch
+    };
+
+    thread_local Cache cache;
+
+    Cache& current() {
+        if (cache.generation != Content::generation) {
+            cache.encounters.clear();
+            cache.drops.clear();
+            cache.generation = Content::generation;
+        }
+        return cache;
+    }
+
+    // Enemies a player of `level` can meet at `location`; may be empty.
+    const Encounters& encounters(uint32_t location, int level) {
+        Cache& c = current();
+        Encounters& t = c.encounters[location];
+        if (level >= t.minLevel && level <= t.maxLevel) return t;
+
+        const auto& pack = Content::pack();
+        const auto& r = pack.location(location);
+        t.enemies.clear();
+        t.weights.clear();
+        t.minLevel = 1; t.maxLevel = INT_MAX;
+        if ((uint64_t)r.firstEncounter + r.encounterCount <= pack.encounterCount()) {
+            for (uint32_t i = 0; i < r.encounterCount; ++i) {
+                const auto& e = *pack.encounter(r.firstEncounter + i);
+                int lo = std::max(1, e.minLevel), hi = e.maxLevel > 0 ? e.maxLevel : INT_MAX;
+                if (level < lo) { t.maxLevel = std::min(t.maxLevel, lo - 1); continue; }
+                if (level > hi) { t.minLevel = std::max(t.minLevel, hi + 1); continue; }
+                t.minLevel = std::max(t.minLevel, lo);
+                t.maxLevel = std::min(t.maxLevel, hi);
+                t.enemies.push_back((EnemyId)e.enemy);
+                t.weights.push_back(e.weight);
+            }
+        }
+        t.alias.build(t.weights);
+        return t;
+    }
+
+    // The enemy's drop, or ItemId::None.
+    ItemId rollDrop(EnemyId id) {
+        Cache& c = current();
+        const auto& pack = Content::pack();
+        if ((size_t)id >= pack.enemyCount()) id = EnemyId::Slime;
+        auto found = c.drops.find((uint32_t)id);
+        if (found == c.drops.end()) {
+            found = c.drops.emplace((uint32_t)id, Drops{}).first;
+            const auto d = pack.enemy(id);
+            c.weights.clear();
+            if ((uint64_t)d.firstDrop + d.dropCount <= pack.dropCount()) {
+                for (size_t i = 0; i < d.dropCount; ++i) {
+                    const auto& drop = *pack.drop(d.firstDrop + i);
+                    found->second.items.push_back(drop.item < pack.itemCount() ? (ItemId)drop.item : ItemId::None);
+                    c.weights.push_back(drop.weight);
+                }
+            }
+            found->second.alias.build(c.weights);
+        }
+        const Drops& t = found->second;
+        return t.alias.empty() ? ItemId::None : t.items[t.alias.sample(rng)];
+    }
+}
+
+inline bool sameItem(const Item& a, const Item& b) {
+    return a.type == b.type && a.power == b.power && a.healAmount == b.healAmount && a.price == b.price && a.name == b.name;
+}
+
+// Equal for items sameItem() considers equal.
+inline uint64_t itemHash(const Item& it) {
+    int32_t fields[4] = { (int32_t)it.type, it.power, it.healAmount, it.price };
+    return SessionLog::fnv1a(std::string_view((const char*)fields, sizeof fields), SessionLog::fnv1a(it.name));
+}
+
+// Inventory of item stacks. Each distinct item is stored once in `defs` and
+// identical items share a stack with a count. Name lookups go through a hash
+// index, and removing a stack swaps the last one into its place, so stack
+// positions can change; a Handle stays valid until its stack is removed.
+// All storage comes from a pmr memory resource, so a simulated hero's
+// inventory can live in the thread's EncounterArena.
 struct Inventory {
-    std::vector<Item> items;
+    struct Handle { uint32_t slot = UINT32_MAX; uint32_t gen = 0; };
+
+    // Storage comes from mr; copies made by copy construction use the
+    // default resource, copy assignment keeps this inventory's resource.
+    explicit Inventory(std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+        : defs(mr), defHash(mr), defByName(mr), defNext(mr), stackOfDef(mr), stacks(mr), slots(mr), freeSlots(mr) {}
+
+    Handle add(const Item& it, int count = 1) { return addDef(intern(it), count); }
+
+    // Core items skip the name hash after their first add.
+    Handle add(ItemId id, int count = 1) {
+        if ((size_t)id >= catalogDef.size()) return add(Content::makeItem(id), count);
+        int& cached = catalogDef[(size_t)id];
+        if (!cached) cached = intern(Content::makeItem(id)) + 1;
+        return addDef(cached - 1, count);
+    }
+
+    size_t size() const { return stacks.size(); }
+    bool empty() const { return stacks.empty(); }
+    const Item& item(size_t pos) const { return defs[stacks[pos].def]; }
+    int count(size_t pos) const { return stacks[pos].count; }
+
+    // Hash of the contents (items and counts, not stack order), kept up to
+    // date on every change.
+    uint64_t hash() const { return contentHash; }
 
-    void add(const Item& it) { items.push_back(it); }
+    long long totalCount() const {
+        long long n = 0;
+        for (const auto& s : stacks) n += s.count;
+        return n;
+    }
 
+    // Stack position of the first item called n, or -1.
     int findByName(const std::string& n) const {
-        for (size_t i = 0; i < items.size(); ++i) if (items[i].name == n) return (int)i;
+        for (int d = firstDefNamed(n); d >= 0; d = defNext[d]) if (stackOfDef[d] >= 0) return stackOfDef[d];
+        return -1;
+    }
+
+    // Stack position of an item identical to it, or -1.
+    int find(const Item& it) const {
+        for (int d = firstDefNamed(it.name); d >= 0; d = defNext[d]) if (sameItem(defs[d], it)) return stackOfDef[d];
         return -1;
     }
 
-    void removeAt(int idx) {
-        if (idx >= 0 && idx < (int)items.size()) items.erase(items.begin() + idx);
+    // Told about every count change: the distinct-item index (stable for
+    // this inventory's lifetime) and the change, or def -1 after clear().
+    // Copies of an inventory start unobserved.
+    struct Observer {
+        void (*changed)(void* ctx, const Inventory& inv, int def, int delta) = nullptr;
+        void* ctx = nullptr;
+
+        Observer() = default;
+        Observer(const Observer&) {}
+        Observer& operator=(const Observer&) { return *this; }
+    };
+    Observer observer;
+
+    const Item& def(int d) const { return defs[d]; }
+
+    Handle handleAt(size_t pos) const { uint32_t slot = stacks[pos].slot; return { slot, slots[slot].gen }; }
+
+    // Current stack position for h, or -1 once its stack has been removed.
+    int position(Handle h) const {
+        if (h.slot >= slots.size() || slots[h.slot].gen != h.gen) return -1;
+        return (int)slots[h.slot].pos;
+    }
+
+    // Removes one item from the stack at pos, dropping the stack when empty.
+    void removeAt(int pos) {
+        if (pos < 0 || pos >= (int)stacks.size()) return;
+        if (observer.changed) observer.changed(observer.ctx, *this, stacks[pos].def, -1);
+        contentHash ^= stackHash(stacks[pos].def, stacks[pos].count);
+        if (--stacks[pos].count > 0) { contentHash ^= stackHash(stacks[pos].def, stacks[pos].count); return; }
+        Stack gone = stacks[pos];
+        stackOfDef[gone.def] = -1;
+        slots[gone.slot].gen++;
+        freeSlots.push_back(gone.slot);
+        if (pos != (int)stacks.size() - 1) {
+            stacks[pos] = stacks.back();
+            stackOfDef[stacks[pos].def] = pos;
+            slots[stacks[pos].slot].pos = (uint32_t)pos;
+        }
+        stacks.pop_back();
+    }
+
+    void clear() {
+        for (const auto& s : stacks) { stackOfDef[s.def] = -1; slots[s.slot].gen++; freeSlots.push_back(s.slot); }
+        stacks.clear();
+        contentHash = 0;
+        if (observer.changed) observer.changed(observer.ctx, *this, -1, 0);
     }
 
     void list() const {
-        if (items.empty()) { std::cout << "  (empty)\n"; return; }
-        for (size_t i = 0; i < items.size(); ++i) {
-            const auto& it = items[i];
-            std::cout << "  [" << i+1 << "] " << it.name << " - ";
-            if (it.type == ItemType::Weapon) std::cout << "Weapon (ATK+" << it.power << ")";
-            else if (it.type == ItemType::Armor) std::cout << "Armor (DEF+" << it.power << ")";
-            else std::cout << "Consumable (Heal " << it.healAmount << ")";
-            std::cout << ", $" << it.price << "\n";
+        if (stacks.empty()) { screen << "  (empty)\n"; return; }
+        for (size_t i = 0; i < stacks.size(); ++i) {
+            const auto& it = item(i);
+            screen << "  [" << i+1 << "] " << it.name;
+            if (stacks[i].count > 1) screen << " x" << stacks[i].count;
+            screen << " - ";
+            if (it.type == ItemType::Weapon) screen << "Weapon (ATK+" << it.power << ")";
+            else if (it.type == ItemType::Armor) screen << "Armor (DEF+" << it.power << ")";
+            else screen << "Consumable (Heal " << it.healAmount << ")";
+            screen << ", $" << it.price << "\n";
+        }
+    }
+
+private:
+    struct Stack { int def; int count; uint32_t slot; };
+    struct Slot { uint32_t pos; uint32_t gen; };
+
+    std::pmr::vector<Item> defs;                          // every distinct item seen
+    std::pmr::vector<uint64_t> defHash;                   // def -> itemHash()
+    std::pmr::unordered_map<std::string, int> defByName;  // name -> first def with it
+    std::pmr::vector<int> defNext;                        // next def sharing a name, or -1
+    std::pmr::vector<int> stackOfDef;                     // def -> stack position, or -1
+    std::pmr::vector<Stack> stacks;
+    std::pmr::vector<Slot> slots;                         // handle slot -> stack position
+    std::pmr::vector<uint32_t> freeSlots;
+    std::array<int, (size_t)ItemId::Count> catalogDef{};  // core ID -> def + 1, 0 = not interned yet
+    uint64_t contentHash = 0;                             // xor of stackHash() over stacks
+
+    uint64_t stackHash(int def, int count) const {
+        uint64_t z = defHash[def] + (uint64_t)count * 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    Handle addDef(int def, int count) {
+        if (observer.changed) observer.changed(observer.ctx, *this, def, count);
+        int pos = stackOfDef[def];
+        if (pos >= 0) {
+            contentHash ^= stackHash(def, stacks[pos].count) ^ stackHash(def, stacks[pos].count + count);
+            stacks[pos].count += count;
+            return handleAt(pos);
+        }
+        contentHash ^= stackHash(def, count);
+        uint32_t slot;
+        if (!freeSlots.empty()) { slot = freeSlots.back(); freeSlots.pop_back(); }
+        else { slot = (uint32_t)slots.size(); slots.push_back({ 0, 0 }); }
+        slots[slot].pos = (uint32_t)stacks.size();
+        stackOfDef[def] = (int)stacks.size();
+        stacks.push_back({ def, count, slot });
+        return { slot, slots[slot].gen };
+    }
+
+    // Below this many distinct items a linear scan beats hashing, and an
+    // unindexed inventory is much cheaper to copy (e.g. a fresh hero).
+    static constexpr size_t indexThreshold = 8;
+
+    int firstDefNamed(const std::string& n) const {
+        if (defs.size() < indexThreshold) {
+            for (size_t d = 0; d < defs.size(); ++d) if (defs[d].name == n) return (int)d;
+            return -1;
+        }
+        auto found = defByName.find(n);
+        return found == defByName.end() ? -1 : found->second;
+    }
+
+    int intern(const Item& it) {
+        int last = -1;
+        for (int d = firstDefNamed(it.name); d >= 0; d = defNext[d]) {
+            if (sameItem(defs[d], it)) return d;
+            last = d;
         }
+        int id = (int)defs.size();
+        defs.push_back(it);
+        defHash.push_back(itemHash(it));
+        defNext.push_back(-1);
+        stackOfDef.push_back(-1);
+        if (last >= 0) defNext[last] = id;
+        if (defs.size() == indexThreshold) {
+            for (size_t d = 0; d < defs.size(); ++d) defByName.emplace(defs[d].name, (int)d);  // keeps the first def per name
+        } else if (defs.size() > indexThreshold && last < 0) {
+            defByName.emplace(it.name, id);
+        }
+        return id;
     }
 };
 
 struct Character {
-    std::string name;
     int level = 1;
     int hp = 30;
     int maxHp = 30;
@@ -77,6 +1265,10 @@ struct Character {
 };
 
 struct Player : Character {
+    Player() = default;
+    explicit Player(std::pmr::memory_resource* mr) : inv(mr) {}
+
+    std::string name;
     int xp = 0;
     int gold = 0;
     Item weapon{ "Fists", ItemType::Weapon, 0, 0, 0 };
@@ -85,57 +1277,131 @@ struct Player : Character {
 
     int atk() const { return attack + weapon.power; }
     int def() const { return defense + armor.power; }
+};
+
+// Levels and XP. Player::xp is the progress into the current level; the
+// curve gives the XP each level needs and the stats it adds. Cumulative
+// thresholds (XP from level 1) are tabled per thread and extended as
+// players climb, so any grant settles with one search of the table and the
+// stat gains are applied once, however many levels it spans.
+namespace Progression {
+    struct Curve {
+        // XP to go from level L to L + 1: base + linear*L + quadratic*L^2, at least 1.
+        long long base = 0, linear = 20, quadratic = 0;
+        int maxLevel = 1000000;
+        int hpPerLevel = 5, attackPerLevel = 2, defensePerLevel = 1;
 
-    void levelUpIfNeeded() {
-        int need = level * 20;
-        while (xp >= need) {
-            xp -= need;
-            level++;
-            maxHp += 5;
-            attack += 2;
-            defense += 1;
-            hp = maxHp;
-            std::cout << Color::yellow << "\n== Level Up! You are now level " << level << "! ==" << Color::reset << "\n";
-            need = level * 20;
+        long long need(int level) const {
+            const double l = level, v = base + linear * l + quadratic * l * l;
+            return v >= 1e18 ? (long long)1e18 : std::max(1LL, (long long)v);
         }
+    };
+
+    Curve curve;              // change with configure(), before any thread plays
+    uint64_t generation = 0;  // bumped by configure(), so thresholds rebuild
+
+    void configure(const Curve& c) { curve = c; generation++; }
+
+    // Called once per settle that gains levels, with the levels before and
+    // after. The default prints the level-up banner unless headless.quiet.
+    using Listener = void (*)(const Player& p, int from, int to);
+
+    void announce(const Player&, int, int to) {
+        if (!headless.quiet) screen << Color::yellow << "\n== Level Up! You are now level " << to << "! ==" << Color::reset << "\n";
     }
-};
 
+    thread_local Listener onLevelUp = announce;
+
+    // Levels tabled up front: ordinary play never grows the table, so it
+    // never allocates after the first level-up.
+    constexpr int initialLevels = 4096;
+
+    struct Thresholds {
+        uint64_t generation = UINT64_MAX;
+        std::vector<long long> total;  // total[L]: XP from level 1 to L; index 0 unused
+
+        // Extends the table until it reaches `xp` total XP or `level`.
+        void extend(long long xp, int level) {
+            level = std::min(level, curve.maxLevel);
+            while ((int)total.size() <= level || (total.back() <= xp && (int)total.size() <= curve.maxLevel)) {
+                const int l = (int)total.size() - 1;
+                total.push_back(std::min((long long)4e18, total.back() + curve.need(l)));
+            }
+        }
+    };
+
+    thread_local Thresholds thresholds;
+
+    Thresholds& current() {
+        if (thresholds.generation != generation) {
+            thresholds.generation = generation;
+            thresholds.total.assign(2, 0);
+            thresholds.extend(0, initialLevels);
+        }
+        return thresholds;
+    }
+
+    // Adds xp (any amount that fits in a long long) and levels p up as far
+    // as its XP reaches. Past maxLevel, XP just accrues.
+    void grant(Player& p, long long xp) {
+        const long long have = p.xp + xp;
+        if (p.level >= curve.maxLevel || have < curve.need(p.level)) { p.xp = (int)std::min<long long>(INT_MAX, have); return; }
+        Thresholds& t = current();
+        const int from = std::max(1, p.level);
+        t.extend(0, from);
+        const long long reached = std::min((long long)4e18, t.total[from] + have);
+        t.extend(reached, from);
+        // Gallop from the current level, then binary search the last step:
+        // O(log levels gained), so small grants stay cheap on a long table.
+        size_t lo = from, step = 1, hi = from + 1;
+        while (hi < t.total.size() && t.total[hi] <= reached) { lo = hi; step *= 2; hi = from + step; }
+        hi = std::min(hi, t.total.size());
+        int to = (int)(std::upper_bound(t.total.begin() + lo, t.total.begin() + hi, reached) - t.total.begin()) - 1;
+        to = std::min(to, curve.maxLevel);
+        const int gained = to - from;
+        p.xp = (int)std::min<long long>(INT_MAX, reached - t.total[to]);
+        p.level = to;
+        p.maxHp += gained * curve.hpPerLevel;
+        p.attack += gained * curve.attackPerLevel;
+        p.defense += gained * curve.defensePerLevel;
+        p.hp = p.maxHp;
+        if (onLevelUp) onLevelUp(p, from, to);
+    }
+}
+
+// A live enemy: catalog ID plus the stats this encounter may have scaled.
 struct Enemy : Character {
+    EnemyId id = EnemyId::Slime;
     int xpReward = 10;
     int goldReward = 5;
-    std::vector<Item> loot;
+
+    const char* name() const { return Content::enemy(id).name; }
 };
 
+Enemy spawnEnemy(EnemyId id) {
+    const auto d = Content::enemy(id);
+    Enemy e; e.id = id; e.level = d.level; e.maxHp = e.hp = d.hp; e.attack = d.attack; e.defense = d.defense; e.xpReward = d.xpReward; e.goldReward = d.goldReward;
+    return e;
+}
+
 namespace Factory {
-    Item potionSmall() { return Item{ "Small Potion", ItemType::Consumable, 0, 15, 10 }; }
-    Item potionLarge() { return Item{ "Large Potion", ItemType::Consumable, 0, 35, 30 }; }
-    Item sword() { return Item{ "Iron Sword", ItemType::Weapon, 4, 0, 40 }; }
-    Item greatsword() { return Item{ "Greatsword", ItemType::Weapon, 8, 0, 100 }; }
-    Item leather() { return Item{ "Leather Armor", ItemType::Armor, 3, 0, 35 }; }
-    Item plate() { return Item{ "Plate Armor", ItemType::Armor, 7, 0, 120 }; }
+    Item potionSmall() { return Content::makeItem(ItemId::PotionSmall); }
+    Item potionLarge() { return Content::makeItem(ItemId::PotionLarge); }
+    Item sword() { return Content::makeItem(ItemId::Sword); }
+    Item greatsword() { return Content::makeItem(ItemId::Greatsword); }
+    Item leather() { return Content::makeItem(ItemId::Leather); }
+    Item plate() { return Content::makeItem(ItemId::Plate); }
 
-    Enemy slime() {
-        Enemy e; e.name = "Green Slime"; e.level = 1; e.maxHp = e.hp = 20; e.attack = 4; e.defense = 1; e.xpReward = 10; e.goldReward = 8; e.loot = { potionSmall() };
-        return e;
-    }
-    Enemy wolf() {
-        Enemy e; e.name = "Wild Wolf"; e.level = 2; e.maxHp = e.hp = 28; e.attack = 6; e.defense = 2; e.xpReward = 16; e.goldReward = 15; e.loot = { potionSmall() };
-        return e;
-    }
-    Enemy bandit() {
-        Enemy e; e.name = "Bandit"; e.level = 3; e.maxHp = e.hp = 36; e.attack = 8; e.defense = 3; e.xpReward = 25; e.goldReward = 25; e.loot = { potionLarge() };
-        return e;
-    }
-    Enemy dragonling() {
-        Enemy e; e.name = "Dragonling"; e.level = 5; e.maxHp = e.hp = 55; e.attack = 12; e.defense = 6; e.xpReward = 45; e.goldReward = 60; e.loot = { greatsword() };
-        return e;
-    }
+    Enemy slime() { return spawnEnemy(EnemyId::Slime); }
+    Enemy wolf() { return spawnEnemy(EnemyId::Wolf); }
+    Enemy bandit() { return spawnEnemy(EnemyId::Bandit); }
+    Enemy dragonling() { return spawnEnemy(EnemyId::Dragonling); }
 }
 
 int clamp(int v, int lo, int hi) { return std::max(lo, std::min(hi, v)); }
 
 int computeDamage(int atk, int def) {
+    RPG_TRACE_SCOPE(ComputeDamage);
     int dmg = atk - def;
     dmg = std::max(1, dmg);
     // +/- 20% variance
@@ -144,169 +1410,350 @@ int computeDamage(int atk, int def) {
     return std::max(1, dmg);
 }
 
-void pressEnter() {
-    std::cout << "\nPress Enter to continue...";
-    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-}
+// Vectorized computeDamage for bulk simulation. Randomness comes from a
+// counter-based stream (value i of stream `key` is a hash of key and i), so
+// every lane's draw is independent of evaluation order and SIMD width.
+// Results are bit-identical to DamageKernel::reference() and match the
+// distribution of computeDamage(); see `rpg --damage-check`.
+namespace DamageKernel {
+    struct Stream {
+        uint32_t key = 0;
+        uint32_t counter = 0;
+    };
 
-void flushLine() {
-    std::cin.clear();
-    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-}
+    inline uint32_t hash32(uint32_t x) {
+        x ^= x >> 16; x *= 0x7feb352dU;
+        x ^= x >> 15; x *= 0x846ca68bU;
+        x ^= x >> 16;
+        return x;
+    }
+
+    inline uint32_t draw(uint32_t keyMix, uint32_t ctr) { return hash32(ctr * 0x9E3779B9U + keyMix); }
+
+    // Scalar definition of the kernel: same formula as computeDamage(), with
+    // the variance drawn as floor(u * width) from a 24-bit uniform u.
+    inline int reference(int atk, int def, uint32_t keyMix, uint32_t ctr) {
+        int dmg = std::max(1, atk - def);
+        int variance = std::max(1, dmg / 5);
+        float u = (float)(draw(keyMix, ctr) >> 8) * (1.0f / 16777216.0f);
+        int r = (int)(u * (float)(2 * variance + 1)) - variance;
+        return std::max(1, dmg + r);
+    }
+
+#if defined(RPG_SIMD_SSE2)
+    inline __m128i mullo32(__m128i a, __m128i b) {
+        __m128i even = _mm_mul_epu32(a, b);
+        __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+    inline __m128i max32(__m128i a, __m128i b) {
+        __m128i gt = _mm_cmpgt_epi32(a, b);
+        return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+    }
+    inline __m128i hash4(__m128i x) {
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 16)); x = mullo32(x, _mm_set1_epi32(0x7feb352d));
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 15)); x = mullo32(x, _mm_set1_epi32((int)0x846ca68bU));
+        return _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+    }
+#endif
+
+    // out[i] = damage for atk[i] vs def[i]; consumes n counters from s.
+    // The float variance step is exact for |atk - def| below 2^22.
+    inline void computeLanes(const int* atk, const int* def, int* out, size_t n, Stream& s) {
+        const uint32_t keyMix = hash32(s.key);
+        size_t i = 0;
+#if defined(RPG_SIMD_AVX2)
+        const __m256i one = _mm256_set1_epi32(1);
+        const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        for (; i + 8 <= n; i += 8) {
+            __m256i a = _mm256_loadu_si256((const __m256i*)(atk + i));
+            __m256i d = _mm256_loadu_si256((const __m256i*)(def + i));
+            __m256i dmg = _mm256_max_epi32(one, _mm256_sub_epi32(a, d));
+            __m256i var = _mm256_max_epi32(one, _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(dmg), _mm256_set1_ps(0.2f))));
+            __m256i ctr = _mm256_add_epi32(_mm256_set1_epi32((int)(s.counter + (uint32_t)i)), lane);
+            __m256i x = _mm256_add_epi32(_mm256_mullo_epi32(ctr, _mm256_set1_epi32((int)0x9E3779B9U)), _mm256_set1_epi32((int)keyMix));
+            x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16)); x = _mm256_mullo_epi32(x, _mm256_set1_epi32(0x7feb352d));
+            x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 15)); x = _mm256_mullo_epi32(x, _mm256_set1_epi32((int)0x846ca68bU));
+            x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+            __m256 u = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(x, 8)), _mm256_set1_ps(1.0f / 16777216.0f));
+            __m256i width = _mm256_add_epi32(_mm256_add_epi32(var, var), one);
+            __m256i r = _mm256_sub_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(u, _mm256_cvtepi32_ps(width))), var);
+            _mm256_storeu_si256((__m256i*)(out + i), _mm256_max_epi32(one, _mm256_add_epi32(dmg, r)));
+        }
+#elif defined(RPG_SIMD_SSE2)
+        const __m128i one = _mm_set1_epi32(1);
+        const __m128i lane = _mm_setr_epi32(0, 1, 2, 3);
+        for (; i + 4 <= n; i += 4) {
+            __m128i a = _mm_loadu_si128((const __m128i*)(atk + i));
+            __m128i d = _mm_loadu_si128((const __m128i*)(def + i));
+            __m128i dmg = max32(one, _mm_sub_epi32(a, d));
+            __m128i var = max32(one, _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(dmg), _mm_set1_ps(0.2f))));
+            __m128i ctr = _mm_add_epi32(_mm_set1_epi32((int)(s.counter + (uint32_t)i)), lane);
+            __m128i x = hash4(_mm_add_epi32(mullo32(ctr, _mm_set1_epi32((int)0x9E3779B9U)), _mm_set1_epi32((int)keyMix)));
+            __m128 u = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(x, 8)), _mm_set1_ps(1.0f / 16777216.0f));
+            __m128i width = _mm_add_epi32(_mm_add_epi32(var, var), one);
+            __m128i r = _mm_sub_epi32(_mm_cvttps_epi32(_mm_mul_ps(u, _mm_cvtepi32_ps(width))), var);
+            _mm_storeu_si128((__m128i*)(out + i), max32(one, _mm_add_epi32(dmg, r)));
+        }
+#endif
+        for (; i < n; ++i) out[i] = reference(atk[i], def[i], keyMix, s.counter + (uint32_t)i);
+        s.counter += (uint32_t)n;
+    }
+
+    inline const char* isaName() {
+#if defined(RPG_SIMD_AVX2)
+        return "AVX2";
+#elif defined(RPG_SIMD_SSE2)
+        return "SSE2";
+#else
+        return "scalar";
+#endif
+    }
+}
+
+namespace Autosave {
+    class Journal;
+    void capture(Journal& journal);
+}
+Autosave::Journal* autosave = nullptr;  // set while a game is autosaving
+
+void pressEnter() {
+    screen << "\nPress Enter to continue...";
+    screen.present();
+    std::string_view line;
+    input.line(line);
+}
+
+enum class Parsed { Number, Blank, Invalid };
+
+// The number a line starts with, after blanks and an optional '+'; the rest
+// of the line is ignored.
+Parsed parseInt(std::string_view line, int& v) {
+    size_t start = line.find_first_not_of(" \t");
+    if (start == std::string_view::npos) return Parsed::Blank;
+    const char* first = line.data() + start;
+    if (*first == '+') ++first;
+    return std::from_chars(first, line.data() + line.size(), v).ec == std::errc() ? Parsed::Number : Parsed::Invalid;
+}
+
+// Presents the frame built so far, then reads a number from the next
+// non-blank line. Waiting for input is when the game autosaves.
+bool readInt(int& v) {
+    if (autosave) Autosave::capture(*autosave);
+    screen.present();
+    std::string_view line;
+    Parsed r;
+    do {
+        if (!input.line(line)) return false;
+        r = parseInt(line, v);
+    } while (r == Parsed::Blank);
+    return r == Parsed::Number;
+}
 
 void showPlayer(const Player& p) {
-    std::cout << Color::cyan << "\n== " << p.name << " ==" << Color::reset << "\n";
-    std::cout << "LVL: " << p.level << "  XP: " << p.xp << "  Gold: " << p.gold << "\n";
-    std::cout << "HP:  " << p.hp << "/" << p.maxHp << "\n";
-    std::cout << "ATK: " << p.atk() << " (Base " << p.attack << "+" << p.weapon.power << ")  DEF: " << p.def() << " (Base " << p.defense << "+" << p.armor.power << ")\n";
-    std::cout << "Weapon: " << p.weapon.name << "  Armor: " << p.armor.name << "\n";
+    screen << Color::cyan << "\n== " << p.name << " ==" << Color::reset << "\n";
+    screen << "LVL: " << p.level << "  XP: " << p.xp << "  Gold: " << p.gold << "\n";
+    screen << "HP:  " << p.hp << "/" << p.maxHp << "\n";
+    screen << "ATK: " << p.atk() << " (Base " << p.attack << "+" << p.weapon.power << ")  DEF: " << p.def() << " (Base " << p.defense << "+" << p.armor.power << ")\n";
+    screen << "Weapon: " << p.weapon.name << "  Armor: " << p.armor.name << "\n";
 }
 
-void equipItem(Player& p) {
-    std::cout << "\nຄັງຂອງ:" << "\n";
-    p.inv.list();
-    std::cout << "\nໃສ່ເລກລາຍການເພື່ອ ໃສ່/ໃຊ້ (0 ຍົກເລີກ): ";
-    int choice; if (!(std::cin >> choice)) { flushLine(); return; }
-    flushLine();
-    if (choice <= 0 || choice > (int)p.inv.items.size()) return;
-    Item it = p.inv.items[choice-1];
+int firstConsumable(const Inventory& inv) {
+    for (size_t i = 0; i < inv.size(); ++i) if (inv.item(i).type == ItemType::Consumable) return (int)i;
+    return -1;
+}
+
+// Equip or drink the inventory item at idx (0-based).
+void useItem(Player& p, int idx) {
+    if (idx < 0 || idx >= (int)p.inv.size()) return;
+    Item it = p.inv.item(idx);
     if (it.type == ItemType::Weapon) {
-        std::cout << "ໃສ່ອາວຸດ: " << it.name << " (ATK+" << it.power << ")\n";
+        if (!headless.quiet) screen << "ໃສ່ອາວຸດ: " << it.name << " (ATK+" << it.power << ")\n";
         p.weapon = it;
     } else if (it.type == ItemType::Armor) {
-        std::cout << "ໃສ່ເກາະ: " << it.name << " (DEF+" << it.power << ")\n";
+        if (!headless.quiet) screen << "ໃສ່ເກາະ: " << it.name << " (DEF+" << it.power << ")\n";
         p.armor = it;
     } else if (it.type == ItemType::Consumable) {
         int before = p.hp;
         p.hp = clamp(p.hp + it.healAmount, 0, p.maxHp);
-        std::cout << Color::green << "+" << (p.hp - before) << " HP" << Color::reset << " ຈາກ " << it.name << "\n";
-        p.inv.removeAt(choice-1);
-        return;
+        if (!headless.quiet) screen << Color::green << "+" << (p.hp - before) << " HP" << Color::reset << " ຈາກ " << it.name << "\n";
+        p.inv.removeAt(idx);
     }
 }
 
+void equipItem(Player& p) {
+    screen << "\nຄັງຂອງ:" << "\n";
+    p.inv.list();
+    screen << "\nໃສ່ເລກລາຍການເພື່ອ ໃສ່/ໃຊ້ (0 ຍົກເລີກ): ";
+    int choice; if (!readInt(choice)) return;
+    useItem(p, choice-1);
+}
+
+// Spends gold on one catalog item; false when the player can't afford it.
+bool buyItem(Player& p, ItemId id) {
+    const auto it = Content::item(id);
+    if (p.gold < it.price) return false;
+    p.gold -= it.price;
+    p.inv.add(id);
+    return true;
+}
+
+void renderShop(const Player& p) {
+    screen << Color::magenta << "\n== ຮ້ານຄ້າ ==" << Color::reset << "  (ທອງ: $" << p.gold << ")\n";
+    const auto& pack = Content::pack();
+    for (size_t i = 0; i < pack.shopSize(); ++i) {
+        const auto it = Content::item(pack.shopItem(i));
+        screen << "  [" << i+1 << "] " << it.name << " - $" << it.price << " (";
+        if (it.type == ItemType::Weapon) screen << "ATK+" << it.power;
+        else if (it.type == ItemType::Armor) screen << "DEF+" << it.power;
+        else screen << "Heal " << it.healAmount;
+        screen << ")\n";
+    }
+    screen << "  [0] ອອກ\nຊື້ລາຍການໃດ? ";
+}
+
 void shop(Player& p) {
-    std::vector<Item> stock = { Factory::potionSmall(), Factory::potionLarge(), Factory::sword(), Factory::leather(), Factory::greatsword(), Factory::plate() };
+    RPG_TRACE_SCOPE(Shop);
+    const size_t stock = Content::pack().shopSize();
     while (true) {
-        std::cout << Color::magenta << "\n== ຮ້ານຄ້າ ==" << Color::reset << "  (ທອງ: $" << p.gold << ")\n";
-        for (size_t i = 0; i < stock.size(); ++i) {
-            const auto& it = stock[i];
-            std::cout << "  [" << i+1 << "] " << it.name << " - $" << it.price << " (";
-            if (it.type == ItemType::Weapon) std::cout << "ATK+" << it.power;
-            else if (it.type == ItemType::Armor) std::cout << "DEF+" << it.power;
-            else std::cout << "Heal " << it.healAmount;
-            std::cout << ")\n";
-        }
-        std::cout << "  [0] ອອກ\nຊື້ລາຍການໃດ? ";
-        int c; if (!(std::cin >> c)) { flushLine(); return; }
-        flushLine();
+        renderShop(p);
+        int c; if (!readInt(c)) return;
         if (c == 0) return;
-        if (c < 0 || c > (int)stock.size()) continue;
-        const Item& it = stock[c-1];
-        if (p.gold < it.price) { std::cout << Color::red << "ທອງບໍ່ພຽງພໍ!" << Color::reset << "\n"; continue; }
-        p.gold -= it.price;
-        p.inv.add(it);
-        std::cout << Color::green << "ຊື້ແລ້ວ: " << it.name << "!" << Color::reset << "\n";
+        if (c < 0 || c > (int)stock) continue;
+        ItemId id = Content::pack().shopItem(c-1);
+        if (!buyItem(p, id)) { screen << Color::red << "ທອງບໍ່ພຽງພໍ!" << Color::reset << "\n"; continue; }
+        screen << Color::green << "ຊື້ແລ້ວ: " << Content::item(id).name << "!" << Color::reset << "\n";
     }
 }
 
 void giveLoot(Player& p, const Enemy& e) {
-    p.xp += e.xpReward;
+    RPG_TRACE_SCOPE(GiveLoot);
     p.gold += e.goldReward;
-    std::cout << Color::yellow << "ໄດ້ຮັບ " << e.xpReward << " XP ແລະ $" << e.goldReward << "!" << Color::reset << "\n";
-    if (!e.loot.empty() && rng.chance(50)) {
-        const Item& it = e.loot[rng.range(0, (int)e.loot.size()-1)];
-        p.inv.add(it);
-        std::cout << Color::yellow << "ໄດ້ຮັບຂອງດອບ: " << it.name << "!" << Color::reset << "\n";
+    if (!headless.quiet) screen << Color::yellow << "ໄດ້ຮັບ " << e.xpReward << " XP ແລະ $" << e.goldReward << "!" << Color::reset << "\n";
+    ItemId drop = Tables::rollDrop(e.id);
+    if (drop != ItemId::None) {
+        p.inv.add(drop);
+        if (!headless.quiet) screen << Color::yellow << "ໄດ້ຮັບຂອງດອບ: " << Content::item(drop).name << "!" << Color::reset << "\n";
     }
-    p.levelUpIfNeeded();
+    Progression::grant(p, e.xpReward);
 }
 
 bool playerTurn(Player& p, Enemy& e) {
-    std::cout << "\nຖຶງຕາເຈົ້າ. ເລືອກການກະທໍາ:\n";
-    std::cout << "  1) ໂຈມຕີ\n  2) ພະລັງໂຈມຕີ (ໃຊ້ 10 HP, ເສຍຫາຍສູງ)\n  3) ໃຊ້/ໃສ່ອຸປະກອນ\n  4) ພະຍາຍາມໜີ\n> ";
-    int c; if (!(std::cin >> c)) { flushLine(); return true; }
-    flushLine();
+    RPG_TRACE_SCOPE(PlayerTurn);
+    int c;
+    if (headless.policy) {
+        c = headless.policy(p, e);
+    } else {
+        screen << "\nຖຶງຕາເຈົ້າ. ເລືອກການກະທໍາ:\n";
+        screen << "  1) ໂຈມຕີ\n  2) ພະລັງໂຈມຕີ (ໃຊ້ 10 HP, ເສຍຫາຍສູງ)\n  3) ໃຊ້/ໃສ່ອຸປະກອນ\n  4) ພະຍາຍາມໜີ\n> ";
+        if (!readInt(c)) return true;
+    }
     if (c == 1) {
         bool crit = rng.chance(15);
         int dmg = computeDamage(p.atk(), e.defense) * (crit ? 2 : 1);
         e.hp = std::max(0, e.hp - dmg);
-        std::cout << Color::green << "ເຈົ້າໂຈມຕີໄດ້ " << dmg << " ຄວາມເສຍຫາຍ" << (crit? " (ຮ້າຍແຮງ)" : "") << "!" << Color::reset << "\n";
+        if (!headless.quiet) screen << Color::green << "ເຈົ້າໂຈມຕີໄດ້ " << dmg << " ຄວາມເສຍຫາຍ" << (crit? " (ຮ້າຍແຮງ)" : "") << "!" << Color::reset << "\n";
     } else if (c == 2) {
-        if (p.hp <= 10) { std::cout << Color::red << "HP ບໍ່ພຽງພໍເພື່ອໃຊ້ພະລັງໂຈມຕີ!" << Color::reset << "\n"; }
+        if (p.hp <= 10) { if (!headless.quiet) screen << Color::red << "HP ບໍ່ພຽງພໍເພື່ອໃຊ້ພະລັງໂຈມຕີ!" << Color::reset << "\n"; }
         else {
             p.hp -= 10;
             int dmg = computeDamage(p.atk()+5, e.defense) + 5;
             e.hp = std::max(0, e.hp - dmg);
-            std::cout << Color::green << "ເຈົ້າໃຊ້ພະລັງໂຈມຕີ ສ້າງ " << dmg << " ຄວາມເສຍຫາຍ!" << Color::reset << "\n";
+            if (!headless.quiet) screen << Color::green << "ເຈົ້າໃຊ້ພະລັງໂຈມຕີ ສ້າງ " << dmg << " ຄວາມເສຍຫາຍ!" << Color::reset << "\n";
         }
     } else if (c == 3) {
-        equipItem(p);
+        if (headless.policy) useItem(p, firstConsumable(p.inv));
+        else equipItem(p);
     } else if (c == 4) {
-        if (rng.chance(40)) { std::cout << Color::yellow << "ໜີສໍາເລັດ!" << Color::reset << "\n"; return false; }
-        else std::cout << Color::red << "ໜີບໍ່ສໍາເລັດ!" << Color::reset << "\n";
+        if (rng.chance(40)) { if (!headless.quiet) screen << Color::yellow << "ໜີສໍາເລັດ!" << Color::reset << "\n"; return false; }
+        else if (!headless.quiet) screen << Color::red << "ໜີບໍ່ສໍາເລັດ!" << Color::reset << "\n";
     }
     return true;
 }
 
 bool enemyTurn(Player& p, Enemy& e) {
+    RPG_TRACE_SCOPE(EnemyTurn);
     if (e.hp <= 0) return true;
     bool special = rng.chance(20);
     int dmg = computeDamage(e.attack + (special?2:0), p.def());
     p.hp = std::max(0, p.hp - dmg);
-    std::cout << Color::red << e.name << " ໂຈມຕີໄດ້ " << dmg << " ຄວາມເສຍຫາຍ" << (special? " ດ້ວຍການໂຈມຕີຮ້າຍແຮງ!" : "!") << Color::reset << "\n";
+    if (!headless.quiet) screen << Color::red << e.name() << " ໂຈມຕີໄດ້ " << dmg << " ຄວາມເສຍຫາຍ" << (special? " ດ້ວຍການໂຈມຕີຮ້າຍແຮງ!" : "!") << Color::reset << "\n";
     return p.hp > 0;
 }
 
+void renderCombatStatus(const Player& p, const Enemy& e) {
+    screen << "\n" << p.name << " HP: " << p.hp << "/" << p.maxHp << "  |  " << e.name() << " HP: " << e.hp << "/" << e.maxHp << "\n";
+}
+
 bool combat(Player& p, Enemy e) {
-    std::cout << Color::red << "\n== " << e.name << " ປາກົດຕົວ! ==" << Color::reset << "\n";
+    RPG_TRACE_SCOPE(Combat);
+    if (!headless.quiet) screen << Color::red << "\n== " << e.name() << " ປາກົດຕົວ! ==" << Color::reset << "\n";
+    headless.lastTurns = 0;
     while (p.hp > 0 && e.hp > 0) {
-        std::cout << "\n" << p.name << " HP: " << p.hp << "/" << p.maxHp << "  |  " << e.name << " HP: " << e.hp << "/" << e.maxHp << "\n";
+        headless.lastTurns++;
+        if (!headless.quiet) renderCombatStatus(p, e);
         bool stayed = playerTurn(p, e);
         if (!stayed) return false; // ran away
         if (e.hp <= 0) break;
         if (!enemyTurn(p, e)) break;
     }
     if (p.hp <= 0) {
-        std::cout << Color::red << "\nເຈົ້າແພ້..." << Color::reset << "\n";
+        if (!headless.quiet) screen << Color::red << "\nເຈົ້າແພ້..." << Color::reset << "\n";
         return false;
     }
-    std::cout << Color::green << "\nເຈົ້າຊະນະ " << e.name << "!" << Color::reset << "\n";
+    if (!headless.quiet) screen << Color::green << "\nເຈົ້າຊະນະ " << e.name() << "!" << Color::reset << "\n";
     giveLoot(p, e);
     return true;
 }
 
+// A location of the active content pack; its encounters come from
+// Tables::encounters(index, level).
 struct Location {
-    std::string name;
-    std::vector<Enemy> encounters;
+    const char* name = "";
+    uint32_t index = 0;
 };
 
-std::vector<Location> buildWorld() {
-    return {
-        { "ທົ່ງຫຍ້າ", { Factory::slime(), Factory::wolf() } },
-        { "ທາງໂຈນ", { Factory::bandit(), Factory::wolf() } },
-        { "ຖ້ຳພູໄຟ", { Factory::dragonling(), Factory::bandit() } }
-    };
+// The active pack's locations. Indexing builds a Location view, so the
+// world costs nothing to set up however many locations the pack holds.
+struct World {
+    size_t size() const { return Content::pack().locationCount(); }
+
+    Location operator[](size_t i) const {
+        const auto& pack = Content::pack();
+        return Location{ pack.str(pack.location(i).name), (uint32_t)i };
+    }
+};
+
+World buildWorld() { return World{}; }
+
+// Text lines end with the number, so names may contain spaces.
+void parseNamePower(const std::string& line, Item& it) {
+    size_t sp = line.find_last_of(' ');
+    if (sp == std::string::npos) { it.name = line; it.power = 0; return; }
+    it.name = line.substr(0, sp);
+    it.power = std::atoi(line.c_str() + sp + 1);
 }
 
 void saveGame(const Player& p, const std::string& path) {
+    RPG_TRACE_SCOPE(SaveGame);
     std::ofstream f(path);
-    if (!f) { std::cout << Color::red << "ບັນທຶກບໍ່ສໍາເລັດ!" << Color::reset << "\n"; return; }
+    if (!f) { if (headless.quiet) return; screen << Color::red << "ບັນທຶກບໍ່ສໍາເລັດ!" << Color::reset << "\n"; return; }
     // Very simple save format
     f << p.name << "\n" << p.level << " " << p.xp << " " << p.gold << "\n";
     f << p.hp << " " << p.maxHp << " " << p.attack << " " << p.defense << "\n";
     f << p.weapon.name << " " << p.weapon.power << "\n";
     f << p.armor.name << " " << p.armor.power << "\n";
-    f << p.inv.items.size() << "\n";
-    for (const auto& it : p.inv.items) {
-        f << (int)it.type << "|" << it.name << "|" << it.power << "|" << it.healAmount << "|" << it.price << "\n";
+    // One line per item, so stacks are written out count times
+    f << p.inv.totalCount() << "\n";
+    for (size_t i = 0; i < p.inv.size(); ++i) {
+        const Item& it = p.inv.item(i);
+        for (int c = 0; c < p.inv.count(i); ++c)
+            f << (int)it.type << "|" << it.name << "|" << it.power << "|" << it.healAmount << "|" << it.price << "\n";
     }
-    std::cout << Color::green << "ບັນທຶກເກມໄວ້ທີ່ " << path << Color::reset << "\n";
+    if (!headless.quiet) screen << Color::green << "ບັນທຶກເກມໄວ້ທີ່ " << path << Color::reset << "\n";
 }
 
-bool loadGame(Player& p, const std::string& path) {
-    std::ifstream f(path);
-    if (!f) return false;
+bool loadGameText(Player& p, std::istream& f) {
     std::string line;
     std::getline(f, p.name);
     if (!std::getline(f, line)) return false; {
@@ -315,14 +1762,12 @@ bool loadGame(Player& p, const std::string& path) {
     if (!std::getline(f, line)) return false; {
         std::istringstream ss(line); ss >> p.hp >> p.maxHp >> p.attack >> p.defense;
     }
-    if (!std::getline(f, line)) return false; {
-        std::istringstream ss(line); ss >> p.weapon.name >> p.weapon.power; p.weapon.type = ItemType::Weapon;
-    }
-    if (!std::getline(f, line)) return false; {
-        std::istringstream ss(line); ss >> p.armor.name >> p.armor.power; p.armor.type = ItemType::Armor;
-    }
+    if (!std::getline(f, line)) return false;
+    parseNamePower(line, p.weapon); p.weapon.type = ItemType::Weapon;
+    if (!std::getline(f, line)) return false;
+    parseNamePower(line, p.armor); p.armor.type = ItemType::Armor;
     size_t n = 0; if (!std::getline(f, line)) return false; { std::istringstream ss(line); ss >> n; }
-    p.inv.items.clear();
+    p.inv.clear();
     for (size_t i = 0; i < n; ++i) {
         if (!std::getline(f, line)) break;
         std::istringstream ss(line);
@@ -339,96 +1784,3789 @@ bool loadGame(Player& p, const std::string& path) {
         }
     }
     p.hp = clamp(p.hp, 0, p.maxHp);
-    std::cout << Color::green << "ໂຫຼດເກມຈາກ " << path << Color::reset << "\n";
     return true;
 }
 
-void explore(Player& p, const Location& loc) {
-    std::cout << Color::blue << "\nກຳລັງສຳຫຼວດ " << loc.name << "..." << Color::reset << "\n";
-    if (rng.chance(60)) {
-        const Enemy& proto = loc.encounters[rng.range(0, (int)loc.encounters.size()-1)];
-        Enemy e = proto;
+bool loadGame(Player& p, const std::string& path) {
+    RPG_TRACE_SCOPE(LoadGame);
+    std::ifstream f(path);
+    if (!f || !loadGameText(p, f)) return false;
+    if (!headless.quiet) screen << Color::green << "ໂຫຼດເກມຈາກ " << path << Color::reset << "\n";
+    return true;
+}
+
+// Binary save format, every field 4 bytes wide in the machine's native byte
+// order (the structs are written as they are in memory, so a save does not
+// move between little- and big-endian machines):
+//   Header | StackRecord[itemCount] | string table (stringBytes)
+// Strings are (offset, length) pairs into the string table, so a mapped
+// file is read in place with no parsing. Bump `version` on layout changes.
+// Version 1 stored a bare ItemRecord per item (no stack count).
+namespace SaveFormat {
+    constexpr char magic[4] = { 'R', 'o', 'R', 'S' };
+    constexpr uint32_t version = 2;
+
+    struct Str { uint32_t offset, length; };
+    struct ItemRecord { Str name; int32_t type, power, healAmount, price; };
+    struct StackRecord { ItemRecord item; int32_t count; };
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t itemCount;
+        uint32_t stringBytes;
+        Str name;
+        int32_t level, xp, gold, hp, maxHp, attack, defense;
+        ItemRecord weapon, armor;
+    };
+    static_assert(sizeof(ItemRecord) == 24 && sizeof(StackRecord) == 28 && sizeof(Header) == 100, "save records must stay unpadded");
+
+    // Zero-copy accessor over a validated save image.
+    class View {
+    public:
+        bool open(const char* data, size_t size) {
+            if (size < sizeof(Header)) return false;
+            base = data;
+            hdr = reinterpret_cast<const Header*>(data);
+            if (std::memcmp(hdr->magic, magic, 4) != 0 || hdr->version < 1 || hdr->version > version) return false;
+            stride = hdr->version == 1 ? sizeof(ItemRecord) : sizeof(StackRecord);
+            uint64_t need = sizeof(Header) + (uint64_t)hdr->itemCount * stride + hdr->stringBytes;
+            if (need != size) return false;
+            strings = data + sizeof(Header) + (size_t)hdr->itemCount * stride;
+            if (!valid(hdr->name) || !valid(hdr->weapon) || !valid(hdr->armor)) return false;
+            for (uint32_t i = 0; i < hdr->itemCount; ++i) if (!valid(item(i)) || count(i) < 1) return false;
+            return true;
+        }
+
+        const Header& header() const { return *hdr; }
+        const ItemRecord& item(uint32_t i) const { return *reinterpret_cast<const ItemRecord*>(base + sizeof(Header) + i * stride); }
+        int32_t count(uint32_t i) const {
+            return hdr->version == 1 ? 1 : reinterpret_cast<const StackRecord*>(base + sizeof(Header))[i].count;
+        }
+        std::string_view str(Str s) const { return std::string_view(strings + s.offset, s.length); }
+
+        Item toItem(const ItemRecord& r) const {
+            return Item{ std::string(str(r.name)), (ItemType)r.type, r.power, r.healAmount, r.price };
+        }
+
+    private:
+        const char* base = nullptr;
+        const char* strings = nullptr;
+        const Header* hdr = nullptr;
+        size_t stride = sizeof(StackRecord);
+
+        bool valid(Str s) const { return (uint64_t)s.offset + s.length <= hdr->stringBytes; }
+        bool valid(const ItemRecord& r) const { return valid(r.name) && r.type >= 0 && r.type <= (int)ItemType::Consumable; }
+    };
+
+    // Builds the string table, storing each distinct string once.
+    class Writer {
+    public:
+        Str intern(const std::string& s) {
+            auto found = index.find(s);
+            if (found != index.end()) return found->second;
+            Str r{ (uint32_t)table.size(), (uint32_t)s.size() };
+            table += s;
+            index.emplace(s, r);
+            return r;
+        }
+        ItemRecord record(const Item& it) { return ItemRecord{ intern(it.name), (int32_t)it.type, it.power, it.healAmount, it.price }; }
+        const std::string& strings() const { return table; }
+
+    private:
+        std::string table;
+        std::unordered_map<std::string, Str> index;
+    };
+}
+
+// The complete save file for p, in memory.
+std::string saveImage(const Player& p) {
+    SaveFormat::Writer w;
+    SaveFormat::Header h{};
+    std::memcpy(h.magic, SaveFormat::magic, 4);
+    h.version = SaveFormat::version;
+    h.itemCount = (uint32_t)p.inv.size();
+    h.name = w.intern(p.name);
+    h.level = p.level; h.xp = p.xp; h.gold = p.gold;
+    h.hp = p.hp; h.maxHp = p.maxHp; h.attack = p.attack; h.defense = p.defense;
+    h.weapon = w.record(p.weapon);
+    h.armor = w.record(p.armor);
+    std::vector<SaveFormat::StackRecord> items;
+    items.reserve(p.inv.size());
+    for (size_t i = 0; i < p.inv.size(); ++i) items.push_back({ w.record(p.inv.item(i)), p.inv.count(i) });
+    h.stringBytes = (uint32_t)w.strings().size();
+    std::string image;
+    image.reserve(sizeof h + items.size() * sizeof(SaveFormat::StackRecord) + w.strings().size());
+    image.append((const char*)&h, sizeof h);
+    image.append((const char*)items.data(), items.size() * sizeof(SaveFormat::StackRecord));
+    image += w.strings();
+    return image;
+}
+
+// Write-only file with an explicit sync, for saves and the autosave writer.
+class SyncedFile {
+public:
+    SyncedFile() = default;
+    SyncedFile(const SyncedFile&) = delete;
+    SyncedFile& operator=(const SyncedFile&) = delete;
+    ~SyncedFile() { close(); }
+
+    // Creates or truncates path.
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        h = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        return h != INVALID_HANDLE_VALUE;
+#else
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        return fd >= 0;
+#endif
+    }
+
+    bool write(std::string_view data) {
+#ifdef _WIN32
+        DWORD done = 0;
+        return h != INVALID_HANDLE_VALUE && WriteFile(h, data.data(), (DWORD)data.size(), &done, nullptr) && done == data.size();
+#else
+        while (!data.empty()) {
+            ssize_t n = ::write(fd, data.data(), data.size());
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            data.remove_prefix((size_t)n);
+        }
+        return true;
+#endif
+    }
+
+    bool sync() {
+#ifdef _WIN32
+        return FlushFileBuffers(h) != 0;
+#else
+        return ::fsync(fd) == 0;
+#endif
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (h != INVALID_HANDLE_VALUE) CloseHandle(h);
+        h = INVALID_HANDLE_VALUE;
+#else
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+#endif
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE h = INVALID_HANDLE_VALUE;
+#else
+    int fd = -1;
+#endif
+};
+
+inline bool replaceFile(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+// Written aside and renamed over the old save, so a crash or a full disk
+// mid-write leaves the previous save intact.
+bool saveGameBinary(const Player& p, const std::string& path) {
+    RPG_TRACE_SCOPE(SaveGame);
+    const std::string image = saveImage(p);
+    const std::string tmp = path + ".tmp";
+    SyncedFile f;
+    bool ok = f.open(tmp) && f.write(image) && f.sync();
+    f.close();
+    ok = ok && replaceFile(tmp, path);
+    if (!ok) {
+        std::remove(tmp.c_str());
+        if (!headless.quiet) screen << Color::red << "ບັນທຶກບໍ່ສໍາເລັດ!" << Color::reset << "\n";
+        return false;
+    }
+    if (!headless.quiet) screen << Color::green << "ບັນທຶກເກມໄວ້ທີ່ " << path << Color::reset << "\n";
+    return true;
+}
+
+// Loads a save image held in memory (see saveImage); p is untouched if the
+// image is invalid.
+bool loadSaveImage(Player& p, const char* data, size_t size) {
+    SaveFormat::View v;
+    if (!v.open(data, size)) return false;
+    const auto& h = v.header();
+    p.name = std::string(v.str(h.name));
+    p.level = h.level; p.xp = h.xp; p.gold = h.gold;
+    p.maxHp = h.maxHp; p.hp = clamp(h.hp, 0, h.maxHp); p.attack = h.attack; p.defense = h.defense;
+    p.weapon = v.toItem(h.weapon);
+    p.armor = v.toItem(h.armor);
+    p.inv.clear();
+    for (uint32_t i = 0; i < h.itemCount; ++i) p.inv.add(v.toItem(v.item(i)), v.count(i));
+    return true;
+}
+
+bool loadGameBinary(Player& p, const std::string& path) {
+    RPG_TRACE_SCOPE(LoadGame);
+    MappedFile file(path);
+    if (!file.ok() || !loadSaveImage(p, file.data(), file.size())) return false;
+    if (!headless.quiet) screen << Color::green << "ໂຫຼດເກມຈາກ " << path << Color::reset << "\n";
+    return true;
+}
+
+// Crash-safe autosave: a snapshot (a save image) plus an append-only journal
+// of what changed since. The game thread only encodes changes into memory; a
+// background thread writes them in batches, so play never waits on the disk.
+//   <save>.autosave  SnapshotHeader | save image
+//   <save>.journal   JournalHeader | (u32 length, u32 checksum, records)*
+// Recovery loads the snapshot and applies the journal's complete batches,
+// stopping at a torn one. Each snapshot starts a new journal generation, so a
+// journal left behind by a crash mid-compaction is recognised and skipped.
+// Records are a tag byte and zigzag LEB128 fields:
+//   'D' def item   'S' def delta   'C'   inventory: item def, stack change, clear
+//   'G' delta  'X' delta  'H' hp  'N' name  'W' item  'A' item
+//   'L' level maxHp attack defense
+namespace Autosave {
+    constexpr char snapshotMagic[4] = { 'R', 'o', 'R', 'A' };
+    constexpr char journalMagic[4] = { 'R', 'o', 'R', 'J' };
+    constexpr uint32_t version = 1;
+
+    struct FileHeader { char magic[4]; uint32_t version; uint64_t generation; };
+    static_assert(sizeof(FileHeader) == 16, "autosave headers must stay unpadded");
+
+    inline void putVar(std::string& out, uint64_t v) {
+        for (; v >= 0x80; v >>= 7) out.push_back((char)(0x80 | (v & 0x7f)));
+        out.push_back((char)v);
+    }
+    inline void putInt(std::string& out, int64_t v) { putVar(out, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63)); }
+    inline void putStr(std::string& out, std::string_view s) { putVar(out, s.size()); out.append(s.data(), s.size()); }
+    inline void putItem(std::string& out, const Item& it) {
+        putStr(out, it.name); putInt(out, (int)it.type); putInt(out, it.power); putInt(out, it.healAmount); putInt(out, it.price);
+    }
+
+    struct Reader {
+        const char* p;
+        const char* end;
+        bool ok = true;
+
+        uint64_t var() {
+            uint64_t v = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                if (p >= end) { ok = false; return 0; }
+                uint8_t b = (uint8_t)*p++;
+                v |= (uint64_t)(b & 0x7f) << shift;
+                if (!(b & 0x80)) return v;
+            }
+            ok = false;
+            return 0;
+        }
+        int integer() { uint64_t v = var(); return (int)(int64_t)((v >> 1) ^ (0 - (v & 1))); }
+        std::string_view str() {
+            uint64_t n = var();
+            if (!ok || n > (uint64_t)(end - p)) { ok = false; return {}; }
+            std::string_view s(p, (size_t)n);
+            p += n;
+            return s;
+        }
+        Item item() {
+            Item it;
+            it.name = std::string(str());
+            int type = integer();
+            it.type = (ItemType)clamp(type, 0, (int)ItemType::Consumable);
+            it.power = integer(); it.healAmount = integer(); it.price = integer();
+            ok = ok && type == (int)it.type;
+            return it;
+        }
+    };
+
+    inline std::string header(const char* magic, uint64_t generation) {
+        FileHeader h{};
+        std::memcpy(h.magic, magic, 4);
+        h.version = version;
+        h.generation = generation;
+        return std::string((const char*)&h, sizeof h);
+    }
+
+    // Owns the autosave files. Jobs run in the order they were queued; a run
+    // of record batches queued while the thread was busy goes out as one
+    // write and one sync.
+    class Writer {
+    public:
+        std::atomic<long long> bytes{0}, batches{0}, snapshots{0};
+        std::atomic<bool> failed{false};
+
+        Writer(std::string snapshotPath, std::string journalPath)
+            : snapshotPath(std::move(snapshotPath)), journalPath(std::move(journalPath)), thread([this] { loop(); }) {}
+
+        ~Writer() {
+            { std::lock_guard<std::mutex> lock(m); stopping = true; }
+            wake.notify_one();
+            thread.join();
+        }
+
+        void records(std::string& data) {
+            {
+                std::lock_guard<std::mutex> lock(m);
+                if (!queue.empty() && !queue.back().snapshot) queue.back().data += data;
+                else queue.push_back({ false, 0, std::move(data) });
+            }
+            data.clear();
+            wake.notify_one();
+        }
+
+        void snapshot(uint64_t generation, std::string image) {
+            { std::lock_guard<std::mutex> lock(m); queue.push_back({ true, generation, std::move(image) }); }
+            wake.notify_one();
+        }
+
+        // Blocks until everything queued so far is on disk.
+        void drain() {
+            std::unique_lock<std::mutex> lock(m);
+            idle.wait(lock, [&] { return queue.empty() && !busy; });
+        }
+
+    private:
+        struct Job { bool snapshot; uint64_t generation; std::string data; };
+
+        std::string snapshotPath, journalPath;
+        SyncedFile journal;
+        std::mutex m;
+        std::condition_variable wake, idle;
+        std::deque<Job> queue;
+        bool stopping = false, busy = false;
+        std::thread thread;
+
+        void loop() {
+            std::unique_lock<std::mutex> lock(m);
+            while (true) {
+                wake.wait(lock, [&] { return stopping || !queue.empty(); });
+                if (queue.empty()) break;
+                std::deque<Job> work;
+                work.swap(queue);
+                busy = true;
+                lock.unlock();
+                std::string batch;
+                for (Job& job : work) {
+                    if (!job.snapshot) { batch += job.data; continue; }
+                    writeBatch(batch);
+                    writeSnapshot(job);
+                }
+                writeBatch(batch);
+                lock.lock();
+                busy = false;
+                idle.notify_all();
+            }
+        }
+
+        void writeBatch(std::string& records) {
+            if (records.empty()) return;
+            uint32_t frame[2] = { (uint32_t)records.size(), (uint32_t)SessionLog::fnv1a(records) };
+            bool ok = journal.write(std::string_view((const char*)frame, sizeof frame)) && journal.write(records) && journal.sync();
+            if (!ok) failed = true;
+            bytes += (long long)(sizeof frame + records.size());
+            batches++;
+            records.clear();
+        }
+
+        // New snapshot first (written aside, then renamed over the old one),
+        // then a fresh journal for its generation.
+        void writeSnapshot(const Job& job) {
+            const std::string tmp = snapshotPath + ".tmp";
+            SyncedFile f;
+            bool ok = f.open(tmp) && f.write(header(snapshotMagic, job.generation)) && f.write(job.data) && f.sync();
+            f.close();
+            ok = ok && replaceFile(tmp, snapshotPath);
+            ok = ok && journal.open(journalPath) && journal.write(header(journalMagic, job.generation)) && journal.sync();
+            if (!ok) failed = true;
+            bytes += (long long)(2 * sizeof(FileHeader) + job.data.size());
+            snapshots++;
+        }
+    };
+
+    // Game-thread side. capture() diffs the player against what was last
+    // journaled; inventory changes arrive through Inventory::Observer as
+    // they happen. Neither touches the disk.
+    class Journal {
+    public:
+        explicit Journal(const std::string& savePath)
+            : snapshotPath(savePath + ".autosave"), journalPath(savePath + ".journal") {}
+
+        ~Journal() { close(true); }
+
+        bool active() const { return writer != nullptr; }
+
+        // Loads the autosave left by a session that did not end cleanly.
+        bool recover(Player& p, long long& batchesApplied) const {
+            batchesApplied = 0;
+            MappedFile snap(snapshotPath);
+            FileHeader h;
+            if (!snap.ok() || snap.size() < sizeof h) return false;
+            std::memcpy(&h, snap.data(), sizeof h);
+            if (std::memcmp(h.magic, snapshotMagic, 4) != 0 || h.version != version) return false;
+            Player r;
+            if (!loadSaveImage(r, snap.data() + sizeof h, snap.size() - sizeof h)) return false;
+            MappedFile log(journalPath);
+            FileHeader jh;
+            if (log.ok() && log.size() >= sizeof jh) {
+                std::memcpy(&jh, log.data(), sizeof jh);
+                if (std::memcmp(jh.magic, journalMagic, 4) == 0 && jh.version == version && jh.generation == h.generation)
+                    batchesApplied = applyJournal(r, log.data() + sizeof jh, log.data() + log.size());
+            }
+            p = std::move(r);
+            return true;
+        }
+
+        // Starts journaling p, which must stay at this address until close().
+        void start(Player& p, long long compactBytes = 256 * 1024) {
+            close(true);
+            compactAt = compactBytes;
+            generation = diskGeneration();
+            writer = std::make_unique<Writer>(snapshotPath, journalPath);
+            player = &p;
+            p.inv.observer.changed = &Journal::onInventory;
+            p.inv.observer.ctx = this;
+            compact(p);
+        }
+
+        // Journals everything that changed since the last capture.
+        void capture() {
+            if (!writer) return;
+            const Player& p = *player;
+            if (p.name != last.name) { pending.push_back('N'); putStr(pending, p.name); }
+            if (p.gold != last.gold) { pending.push_back('G'); putInt(pending, (int64_t)p.gold - last.gold); }
+            if (p.xp != last.xp) { pending.push_back('X'); putInt(pending, (int64_t)p.xp - last.xp); }
+            if (p.level != last.level || p.maxHp != last.maxHp || p.attack != last.attack || p.defense != last.defense) {
+                pending.push_back('L');
+                for (int v : { p.level, p.maxHp, p.attack, p.defense }) putInt(pending, v);
+            }
+            if (p.hp != last.hp) { pending.push_back('H'); putInt(pending, p.hp); }
+            if (!sameItem(p.weapon, last.weapon)) { pending.push_back('W'); putItem(pending, p.weapon); }
+            if (!sameItem(p.armor, last.armor)) { pending.push_back('A'); putItem(pending, p.armor); }
+            if (pending.empty()) return;
+            remember(p);
+            journaled += (long long)pending.size();
+            writer->records(pending);
+            if (journaled >= 2 * compactLimit()) compact(p);  // input never let the game idle
+        }
+
+        // Compacts a journal that has outgrown its snapshot. Runs while the
+        // game waits for input, so play does not stall on the snapshot.
+        void idle() { if (writer && player && journaled >= compactLimit()) compact(*player); }
+
+        // Replaces the journal with a fresh snapshot of p, which already
+        // holds any inventory changes not yet captured.
+        void compact(const Player& p) {
+            if (!writer) return;
+            pending.clear();
+            std::string image = saveImage(p);
+            snapshotBytes = (long long)image.size();
+            journaled = 0;
+            announced.assign(announced.size(), false);
+            remember(p);
+            writer->snapshot(++generation, std::move(image));
+        }
+
+        // Ends journaling once everything queued is written. A clean end
+        // (keep = false) deletes the autosave; otherwise it stays for
+        // recover(), as it would after a crash.
+        void close(bool keep) {
+            if (!writer) return;
+            if (player) player->inv.observer = Inventory::Observer{};
+            player = nullptr;
+            writer.reset();
+            if (!keep) { std::remove(snapshotPath.c_str()); std::remove(journalPath.c_str()); }
+        }
+
+        // Waits until everything captured so far is on disk.
+        void flush() { if (writer) writer->drain(); }
+
+        bool failed() const { return writer && writer->failed; }
+        const Writer* stats() const { return writer.get(); }
+
+    private:
+        struct Last { std::string name; int gold = 0, xp = 0, level = 0, maxHp = 0, attack = 0, defense = 0, hp = 0; Item weapon, armor; };
+
+        std::string snapshotPath, journalPath;
+        std::unique_ptr<Writer> writer;
+        Player* player = nullptr;
+        std::string pending;
+        Last last;
+        std::vector<bool> announced;  // inventory defs already described in this generation
+        uint64_t generation = 0;
+        long long journaled = 0, snapshotBytes = 0, compactAt = 0;
+
+        long long compactLimit() const { return std::max(compactAt, snapshotBytes); }
+
+        // The newest generation left on disk. Snapshots continue from it, so
+        // a crash between a new snapshot and its fresh journal can never
+        // pair that snapshot with a journal it already contains.
+        uint64_t diskGeneration() const {
+            uint64_t g = 0;
+            for (const auto& [path, magic] : { std::pair{ &snapshotPath, snapshotMagic }, std::pair{ &journalPath, journalMagic } }) {
+                MappedFile f(*path);
+                FileHeader h;
+                if (!f.ok() || f.size() < sizeof h) continue;
+                std::memcpy(&h, f.data(), sizeof h);
+                if (std::memcmp(h.magic, magic, 4) == 0 && h.version == version) g = std::max(g, h.generation);
+            }
+            return g;
+        }
+
+        void remember(const Player& p) {
+            last.name = p.name; last.gold = p.gold; last.xp = p.xp; last.level = p.level; last.maxHp = p.maxHp;
+            last.attack = p.attack; last.defense = p.defense; last.hp = p.hp; last.weapon = p.weapon; last.armor = p.armor;
+        }
+
+        static void onInventory(void* ctx, const Inventory& inv, int def, int delta) {
+            Journal& j = *static_cast<Journal*>(ctx);
+            if (def < 0) { j.pending.push_back('C'); return; }
+            if ((size_t)def >= j.announced.size()) j.announced.resize((size_t)def + 1, false);
+            if (!j.announced[def]) {
+                j.announced[def] = true;
+                j.pending.push_back('D'); putVar(j.pending, (uint64_t)def); putItem(j.pending, inv.def(def));
+            }
+            j.pending.push_back('S'); putVar(j.pending, (uint64_t)def); putInt(j.pending, delta);
+        }
+
+        // Applies complete, intact batches; returns how many.
+        static long long applyJournal(Player& p, const char* pos, const char* end) {
+            std::vector<Item> defs;
+            long long applied = 0;
+            while (end - pos >= 8) {
+                uint32_t frame[2];
+                std::memcpy(frame, pos, sizeof frame);
+                if (frame[0] > (uint64_t)(end - pos - 8)) break;
+                std::string_view records(pos + 8, frame[0]);
+                if ((uint32_t)SessionLog::fnv1a(records) != frame[1]) break;
+                pos += 8 + frame[0];
+                Reader r{ records.data(), records.data() + records.size() };
+                while (r.ok && r.p < r.end) {
+                    char tag = *r.p++;
+                    switch (tag) {
+                    case 'D': {
+                        uint64_t id = r.var();
+                        Item it = r.item();
+                        if (!r.ok || id > 1u << 24) { r.ok = false; break; }
+                        if (id >= defs.size()) defs.resize(id + 1);
+                        defs[id] = std::move(it);
+                        break;
+                    }
+                    case 'S': {
+                        uint64_t id = r.var();
+                        int delta = r.integer();
+                        if (!r.ok || id >= defs.size()) { r.ok = false; break; }
+                        if (delta > 0) p.inv.add(defs[id], delta);
+                        for (; delta < 0; ++delta) {
+                            int at = p.inv.find(defs[id]);
+                            if (at < 0) break;
+                            p.inv.removeAt(at);
+                        }
+                        break;
+                    }
+                    case 'C': p.inv.clear(); break;
+                    case 'N': p.name = std::string(r.str()); break;
+                    case 'G': p.gold += r.integer(); break;
+                    case 'X': p.xp += r.integer(); break;
+                    case 'L': p.level = r.integer(); p.maxHp = r.integer(); p.attack = r.integer(); p.defense = r.integer(); break;
+                    case 'H': p.hp = r.integer(); break;
+                    case 'W': p.weapon = r.item(); break;
+                    case 'A': p.armor = r.item(); break;
+                    default: r.ok = false;
+                    }
+                }
+                if (!r.ok) break;
+                applied++;
+            }
+            p.hp = clamp(p.hp, 0, p.maxHp);
+            return applied;
+        }
+    };
+
+    void capture(Journal& journal) { journal.capture(); }
+}
+
+// What an exploration step turns up: a fight 60% of the time, otherwise a
+// purse (40%), a potion (30%) or a quiet rest (30%).
+enum class ExploreEvent : uint32_t { Fight, Gold, Potion, Rest };
+const std::vector<uint32_t> exploreEventWeights = { 60, 16, 12, 12 };
+
+// Event tables with and without the fight, for places with no enemy at the
+// player's level.
+const AliasTable& exploreEvents(bool canFight) {
+    static const AliasTable withFight = [] { AliasTable t; t.build(exploreEventWeights); return t; }();
+    static const AliasTable noFight = [] {
+        auto w = exploreEventWeights;
+        w[(size_t)ExploreEvent::Fight] = 0;
+        AliasTable t; t.build(w); return t;
+    }();
+    return canFight ? withFight : noFight;
+}
+
+// One trip to loc; returns what happened.
+ExploreEvent explore(Player& p, const Location& loc) {
+    if (!headless.quiet) screen << Color::blue << "\nກຳລັງສຳຫຼວດ " << loc.name << "..." << Color::reset << "\n";
+    const auto& encounters = Tables::encounters(loc.index, p.level);
+    const auto event = (ExploreEvent)exploreEvents(!encounters.empty()).sample(rng);
+    switch (event) {
+    case ExploreEvent::Fight: {
+        Enemy e = spawnEnemy(encounters.sample());
         // slight random scaling
         e.attack += rng.range(0, 2);
         e.defense += rng.range(0, 2);
         e.maxHp += rng.range(0, 6); e.hp = e.maxHp;
         combat(p, e);
-    } else {
-        int eventRoll = rng.range(1, 100);
-        if (eventRoll <= 40) {
-            int found = rng.range(5, 25);
-            p.gold += found;
-            std::cout << Color::yellow << "ເຈົ້າພົບຖົງເງິນ: $" << found << "!" << Color::reset << "\n";
-        } else if (eventRoll <= 70) {
-            Item it = rng.chance(50) ? Factory::potionSmall() : Factory::potionLarge();
-            p.inv.add(it);
-            std::cout << Color::yellow << "ເຈົ້າພົບຂອງ: " << it.name << "!" << Color::reset << "\n";
-        } else {
-            std::cout << "ເງີຍສະງົບ... ເຈົ້າພັກເພີ່ຍໆ ແລະ ຟື້ນ 5 HP.\n";
-            p.hp = clamp(p.hp + 5, 0, p.maxHp);
-        }
+        break;
     }
+    case ExploreEvent::Gold: {
+        int found = rng.range(5, 25);
+        p.gold += found;
+        if (!headless.quiet) screen << Color::yellow << "ເຈົ້າພົບຖົງເງິນ: $" << found << "!" << Color::reset << "\n";
+        break;
+    }
+    case ExploreEvent::Potion: {
+        ItemId found = rng.chance(50) ? ItemId::PotionSmall : ItemId::PotionLarge;
+        p.inv.add(found);
+        if (!headless.quiet) screen << Color::yellow << "ເຈົ້າພົບຂອງ: " << Content::item(found).name << "!" << Color::reset << "\n";
+        break;
+    }
+    case ExploreEvent::Rest:
+        if (!headless.quiet) screen << "ເງີຍສະງົບ... ເຈົ້າພັກເພີ່ຍໆ ແລະ ຟື້ນ 5 HP.\n";
+        p.hp = clamp(p.hp + 5, 0, p.maxHp);
+        break;
+    }
+    return event;
 }
 
-void mainMenu(Player& p) {
-    auto world = buildWorld();
-    while (true) {
-        std::cout << Color::bold << "\n===== Rift of Realms: ເກມ RPG ແບບຂໍ້ຄວາມ =====" << Color::reset << "\n";
-        showPlayer(p);
-        std::cout << "\nເລືອກການກະທໍາ:\n";
-        std::cout << "  1) ສໍາຫຼວດ\n  2) ຮ້ານຄ້າ\n  3) ຄັງຂອງ/ໃສ່ອຸປະກອນ\n  4) ບັນທຶກເກມ\n  5) ໂຫຼດເກມ\n  6) ພັກຜ່ອນທີ່ໂຮງແຮມ ($10)\n  7) ອອກ\n> ";
-        int c; if (!(std::cin >> c)) { flushLine(); continue; }
-        flushLine();
-        if (c == 1) {
-            std::cout << "ເລືອກສະຖານທີ່:\n";
-            for (size_t i = 0; i < world.size(); ++i) std::cout << "  [" << i+1 << "] " << world[i].name << "\n";
-            std::cout << "  [0] ຍົກເລີກ\n> ";
-            int l; if (!(std::cin >> l)) { flushLine(); continue; }
-            flushLine();
-            if (l <= 0 || l > (int)world.size()) continue;
-            explore(p, world[l-1]);
-        } else if (c == 2) {
-            shop(p);
-        } else if (c == 3) {
-            equipItem(p);
-        } else if (c == 4) {
-            saveGame(p, "save.txt");
-        } else if (c == 5) {
-            if (!loadGame(p, "save.txt")) std::cout << Color::red << "ບໍ່ພົບໄຟລ໌ບັນທຶກ." << Color::reset << "\n";
-        } else if (c == 6) {
-            if (p.gold < 10) std::cout << Color::red << "ທອງບໍ່ພຽງພໍ!" << Color::reset << "\n";
-            else { p.gold -= 10; p.hp = p.maxHp; std::cout << Color::green << "ເຈົ້າຮູ້ສຶກຟື້ນຟູ!" << Color::reset << "\n"; }
-        } else if (c == 7) {
-            std::cout << "ລາກ່ອນ ນັກຜະຈົນໄພ!\n";
-            break;
+Player newHero() {
+    Player p; p.name = "Hero"; p.level = 1; p.maxHp = p.hp = 35; p.attack = 6; p.defense = 2; p.gold = 30;
+    p.inv.add(ItemId::PotionSmall, 2);
+    return p;
+}
+
+// Scripted player for headless runs: drink a potion when low, power attack
+// while healthy and the enemy is still tough, otherwise attack. Never runs.
+int scriptedPolicy(const Player& p, const Enemy& e) {
+    if (p.hp * 100 < p.maxHp * 35 && firstConsumable(p.inv) >= 0) return 3;
+    if (p.hp > 10 && p.hp * 100 >= p.maxHp * 60 && e.hp > p.atk() * 2) return 2;
+    return 1;
+}
+
+struct SimResult {
+    long long fights = 0;
+    long long wins = 0;
+    long long turns = 0;
+    std::array<long long, 32> turnHist{};  // last bucket collects 31+ turns
+
+    void record(bool won, int t) {
+        fights++;
+        wins += won;
+        turns += t;
+        turnHist[std::min(t, (int)turnHist.size() - 1)]++;
+    }
+};
+
+std::vector<Enemy> simPrototypes() {
+    return { Factory::slime(), Factory::wolf(), Factory::bandit(), Factory::dragonling() };
+}
+
+// Fights a fresh level-1 hero against proto `fights` times without console I/O.
+SimResult simulate(const Enemy& proto, long long fights) {
+    Headless saved = headless;
+    headless.quiet = true;
+    headless.policy = scriptedPolicy;
+    SimResult r;
+    const Player hero = newHero();
+    for (long long i = 0; i < fights; ++i) {
+        {
+            Player p(encounterArena.resource());
+            p = hero;  // copy-assign keeps the arena as p's allocator
+            bool won = combat(p, proto);
+            r.record(won, headless.lastTurns);
         }
+        encounterArena.reset();
     }
+    headless = saved;
+    return r;
 }
 
-int main() {
-    std::ios::sync_with_stdio(false);
-    std::cin.tie(nullptr);
-#ifdef _WIN32
-    // Switch console to UTF-8 and enable ANSI colors on Windows
-    SetConsoleOutputCP(65001);
-    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-    if (hOut != INVALID_HANDLE_VALUE) {
-        DWORD mode = 0; GetConsoleMode(hOut, &mode);
-        mode |= 0x0004; // ENABLE_VIRTUAL_TERMINAL_PROCESSING
-        SetConsoleMode(hOut, mode);
+double secondsSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+void printSimResult(const std::string& name, const SimResult& r, double secs) {
+    std::cout << Color::bold << "\n== " << name << " ==" << Color::reset << "\n";
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Fights: " << r.fights << "  Fights/sec: " << (secs > 0 ? r.fights / secs : 0.0)
+              << "  Win rate: " << (r.fights ? 100.0 * r.wins / r.fights : 0.0) << "%"
+              << "  Avg turns: " << std::setprecision(2) << (r.fights ? (double)r.turns / r.fights : 0.0) << "\n";
+    long long peak = *std::max_element(r.turnHist.begin(), r.turnHist.end());
+    for (size_t t = 0; t < r.turnHist.size(); ++t) {
+        if (!r.turnHist[t]) continue;
+        int bar = peak ? (int)(40 * r.turnHist[t] / peak) : 0;
+        std::cout << "  " << std::setw(3) << t << (t + 1 == r.turnHist.size() ? "+" : " ") << " | "
+                  << std::string(bar, '#') << " " << r.turnHist[t] << "\n";
     }
-#endif
+    std::cout << std::defaultfloat;
+}
 
-    Player p; p.name = "Hero"; p.level = 1; p.maxHp = p.hp = 35; p.attack = 6; p.defense = 2; p.gold = 30;
-    p.inv.add(Factory::potionSmall());
-    p.inv.add(Factory::potionSmall());
+// rpg --sim [fights] [seed]: full report with turns-per-fight histograms.
+int runSim(long long fights, unsigned seed) {
+    rng.seed(seed);
+    fights = std::max(1LL, fights);
+    for (const auto& proto : simPrototypes()) {
+        auto t0 = std::chrono::steady_clock::now();
+        SimResult r = simulate(proto, fights);
+        printSimResult(proto.name(), r, secondsSince(t0));
+    }
+    return 0;
+}
 
-    std::cout << Color::bold << "\nຍິນດີຕ້ອນຮັບສູ່ Rift of Realms!" << Color::reset << "\n";
-    std::cout << "ໃສ່ຊື່ຮີໂຣ (ກົດ Enter ເພື່ອ 'Hero'): ";
-    std::string nm; std::getline(std::cin, nm);
-    if (!nm.empty()) p.name = nm;
+// rpg --bench [fights]: one line per enemy plus the total, for tracking
+// fights/sec from build to build.
+int runBench(long long fights) {
+    rng.seed(12345);
+    fights = std::max(1LL, fights);
+    long long total = 0;
+    double totalSecs = 0;
+    std::cout << std::fixed << std::setprecision(0);
+    for (const auto& proto : simPrototypes()) {
+        auto t0 = std::chrono::steady_clock::now();
+        SimResult r = simulate(proto, fights);
+        double secs = secondsSince(t0);
+        total += r.fights; totalSecs += secs;
+        std::cout << std::left << std::setw(12) << proto.name() << std::right << std::setw(12) << (secs > 0 ? r.fights / secs : 0.0) << " fights/sec\n";
+    }
+    std::cout << std::left << std::setw(12) << "TOTAL" << std::right << std::setw(12) << (totalSecs > 0 ? total / totalSecs : 0.0) << " fights/sec\n";
+    std::cout << std::defaultfloat;
+    return 0;
+}
 
-    mainMenu(p);
+// Enemy stats for the batched engine, indexed by table ID. Names and loot
+// stay in the content pack (via `kind`), so the combat loop below never touches
+// strings or vectors.
+struct EnemyTable {
+    std::vector<EnemyId> kind;
+    std::vector<int> hp, attack, defense, level, xpReward, goldReward;
+
+    int add(const Enemy& e) {
+        kind.push_back(e.id);
+        hp.push_back(e.maxHp); attack.push_back(e.attack); defense.push_back(e.defense);
+        level.push_back(e.level); xpReward.push_back(e.xpReward); goldReward.push_back(e.goldReward);
+        return (int)kind.size() - 1;
+    }
+    const char* name(int id) const { return Content::enemy(kind[id]).name; }
+};
+
+// Many concurrent encounters in structure-of-arrays form. Each lane is one
+// fight between a hero (potions as a plain count) and an enemy ID; damage
+// for all lanes comes from DamageKernel::computeLanes() in one call. Lanes
+// [0, active) are still fighting; finished lanes are swapped past `active`.
+struct CombatBatch {
+    int potionHeal = Content::item(ItemId::PotionSmall).healAmount;
+
+    std::vector<int> pHp, pMaxHp, pAtk, pDef, pPotions;
+    std::vector<int> eHp, eAtk, eDef, enemyId, turns;
+    std::vector<int> action, atkBuf, defBuf, dmgBuf;  // per-tick scratch
+    DamageKernel::Stream stream;
+    size_t active = 0;
+
+    size_t size() const { return pHp.size(); }
+    bool won(size_t i) const { return pHp[i] > 0; }
+
+    void clear() {
+        for (auto* v : lanes()) v->clear();
+        stream = { Rand::bits32(rng.gen), 0 };
+        active = 0;
+    }
+
+    void add(const Player& p, int potions, const EnemyTable& t, int id) {
+        pHp.push_back(p.hp); pMaxHp.push_back(p.maxHp); pAtk.push_back(p.atk()); pDef.push_back(p.def()); pPotions.push_back(potions);
+        eHp.push_back(t.hp[id]); eAtk.push_back(t.attack[id]); eDef.push_back(t.defense[id]); enemyId.push_back(id); turns.push_back(0);
+        active = size();
+    }
+
+    // One round for every active lane, following scriptedPolicy().
+    void tick() {
+        const size_t n = active;
+        action.resize(n); atkBuf.resize(n); defBuf.resize(n); dmgBuf.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            turns[i]++;
+            if (pHp[i] * 100 < pMaxHp[i] * 35 && pPotions[i] > 0) action[i] = 3;
+            else if (pHp[i] > 10 && pHp[i] * 100 >= pMaxHp[i] * 60 && eHp[i] > pAtk[i] * 2) action[i] = 2;
+            else action[i] = 1;
+            atkBuf[i] = pAtk[i] + (action[i] == 2 ? 5 : 0);
+        }
+        DamageKernel::computeLanes(atkBuf.data(), eDef.data(), dmgBuf.data(), n, stream);
+        for (size_t i = 0; i < n; ++i) {
+            if (action[i] == 3) { pPotions[i]--; pHp[i] = std::min(pMaxHp[i], pHp[i] + potionHeal); continue; }
+            int dmg = dmgBuf[i];
+            if (action[i] == 2) { pHp[i] -= 10; dmg += 5; }
+            else if (rng.chance(15)) dmg *= 2;
+            eHp[i] = std::max(0, eHp[i] - dmg);
+        }
+        for (size_t i = 0; i < n; ++i) atkBuf[i] = eAtk[i] + (rng.chance(20) ? 2 : 0);
+        DamageKernel::computeLanes(atkBuf.data(), pDef.data(), dmgBuf.data(), n, stream);
+        for (size_t i = 0; i < n; ++i) if (eHp[i] > 0) pHp[i] = std::max(0, pHp[i] - dmgBuf[i]);
+
+        for (size_t i = 0; i < active;) {
+            if (pHp[i] > 0 && eHp[i] > 0) { ++i; continue; }
+            swapLanes(i, --active);
+        }
+    }
+
+    void run() { while (active) tick(); }
+
+private:
+    std::array<std::vector<int>*, 10> lanes() {
+        return { &pHp, &pMaxHp, &pAtk, &pDef, &pPotions, &eHp, &eAtk, &eDef, &enemyId, &turns };
+    }
+    void swapLanes(size_t a, size_t b) {
+        if (a == b) return;
+        for (auto* v : lanes()) std::swap((*v)[a], (*v)[b]);
+    }
+};
+
+// Two-sample chi-square statistic over the damage values seen in a and b.
+// Returns the statistic and stores the degrees of freedom in dof.
+double chiSquareHomogeneity(const std::vector<long long>& a, const std::vector<long long>& b, int& dof) {
+    long long na = 0, nb = 0;
+    for (size_t i = 0; i < a.size(); ++i) { na += a[i]; nb += b[i]; }
+    double chi = 0;
+    dof = -1;
+    for (size_t i = 0; i < a.size(); ++i) {
+        long long col = a[i] + b[i];
+        if (!col) continue;
+        dof++;
+        double ea = (double)col * na / (na + nb), eb = (double)col * nb / (na + nb);
+        chi += (a[i] - ea) * (a[i] - ea) / ea + (b[i] - eb) * (b[i] - eb) / eb;
+    }
+    return chi;
+}
+
+// Chi-square critical value at p = 0.001 (Wilson-Hilferty approximation).
+double chiSquareCritical(int dof) {
+    double k = std::max(1, dof), z = 3.09;
+    double t = 1 - 2 / (9 * k) + z * std::sqrt(2 / (9 * k));
+    return k * t * t * t;
+}
+
+// rpg --damage-check [samples]: verifies the SIMD kernel against its scalar
+// reference bit for bit, checks its distribution against computeDamage()
+// with a chi-square test, and reports damage rolls/sec for both paths.
+// Sample counts below 1000 are raised to it: smaller histograms leave the
+// chi-square test with too few rolls per bin to mean anything.
+int runDamageCheck(long long samples) {
+    rng.seed(2024);
+    samples = std::max(1000LL, samples);
+    bool ok = true;
+    const size_t n = 1 << 16;
+    std::vector<int> atk(n), def(n), out(n);
+    for (size_t i = 0; i < n; ++i) { atk[i] = rng.range(0, 4000); def[i] = rng.range(0, 4000); }
+
+    DamageKernel::Stream s{ 7, 0 };
+    DamageKernel::computeLanes(atk.data(), def.data(), out.data(), n, s);
+    uint32_t keyMix = DamageKernel::hash32(7);
+    size_t mismatches = 0;
+    for (size_t i = 0; i < n; ++i) mismatches += out[i] != DamageKernel::reference(atk[i], def[i], keyMix, (uint32_t)i);
+    std::cout << "Kernel: " << DamageKernel::isaName() << "\n";
+    std::cout << "Exact check vs scalar reference: " << mismatches << " mismatches in " << n << " lanes "
+              << (mismatches ? "FAIL" : "PASS") << "\n";
+    ok &= mismatches == 0;
+
+    const std::pair<int, int> pairs[] = { {6, 1}, {6, 2}, {10, 3}, {14, 6}, {30, 2}, {4, 8}, {100, 10} };
+    for (auto [a, d] : pairs) {
+        std::vector<long long> scalar(256), simd(256);
+        std::vector<int> av((size_t)samples, a), dv((size_t)samples, d), o((size_t)samples);
+        for (long long i = 0; i < samples; ++i) scalar[std::min(255, computeDamage(a, d))]++;
+        DamageKernel::Stream st{ (uint32_t)a * 131 + (uint32_t)d, 0 };
+        DamageKernel::computeLanes(av.data(), dv.data(), o.data(), o.size(), st);
+        for (int v : o) simd[std::min(255, v)]++;
+        int dof;
+        double chi = chiSquareHomogeneity(scalar, simd, dof);
+        double crit = chiSquareCritical(dof);
+        bool pass = dof == 0 || chi < crit;
+        ok &= pass;
+        std::cout << std::fixed << std::setprecision(2) << "Chi-square atk " << a << " def " << d << ": " << chi
+                  << " (dof " << dof << ", critical " << crit << ") " << (pass ? "PASS" : "FAIL") << "\n" << std::defaultfloat;
+    }
+
+    const int reps = 200;
+    volatile long long sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; ++r) for (size_t i = 0; i < n; ++i) sink = sink + computeDamage(atk[i] & 63, def[i] & 15);
+    double scalarSecs = secondsSince(t0);
+    for (size_t i = 0; i < n; ++i) { atk[i] &= 63; def[i] &= 15; }
+    t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; ++r) { DamageKernel::computeLanes(atk.data(), def.data(), out.data(), n, s); sink = sink + out[r]; }
+    double simdSecs = secondsSince(t0);
+    std::cout << std::fixed << std::setprecision(0)
+              << "computeDamage: " << reps * n / scalarSecs << " rolls/sec\n"
+              << "Kernel:        " << reps * n / simdSecs << " rolls/sec\n" << std::defaultfloat;
+    return ok ? 0 : 1;
+}
+
+// rpg --save-bench [items]: save/load timings for the text and binary
+// formats with a large inventory, plus a round-trip check.
+int runSaveBench(long long items) {
+    Headless saved = headless;
+    headless.quiet = true;
+    Player p = newHero();
+    p.name = "Bench Hero";
+    p.weapon = Factory::greatsword(); p.weapon.name = "Great Sword of Testing";
+    p.armor = Factory::plate();
+    const Item kinds[] = { Factory::potionSmall(), Factory::potionLarge(), Factory::sword(), Factory::leather(), Factory::greatsword(), Factory::plate() };
+    for (long long i = 0; i < items; ++i) {
+        Item it = kinds[i % 6];
+        it.name += " #" + std::to_string(i);
+        p.inv.add(it);
+    }
+
+    const int reps = 5;
+    auto time = [&](auto&& fn) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; ++r) fn();
+        return secondsSince(t0) * 1000.0 / reps;
+    };
+    Player q;
+    double textSave = time([&] { saveGame(p, "bench_save.txt"); });
+    double textLoad = time([&] { q = Player(); loadGame(q, "bench_save.txt"); });
+    bool textOk = q.inv.size() == p.inv.size() && q.inv.totalCount() == p.inv.totalCount() && q.weapon.name == p.weapon.name;
+    double binSave = time([&] { saveGameBinary(p, "bench_save.dat"); });
+    double binLoad = time([&] { q = Player(); loadGameBinary(q, "bench_save.dat"); });
+    bool binOk = q.inv.size() == p.inv.size() && q.weapon.name == p.weapon.name && q.name == p.name;
+    for (size_t i = 0; binOk && i < p.inv.size(); ++i) binOk = sameItem(q.inv.item(i), p.inv.item(i)) && q.inv.count(i) == p.inv.count(i);
+    long long sink = 0;
+    double viewOpen = time([&] {
+        MappedFile f("bench_save.dat");
+        SaveFormat::View v;
+        if (f.ok() && v.open(f.data(), f.size())) sink += v.header().itemCount;
+    });
+    std::ifstream ts("bench_save.txt", std::ios::binary | std::ios::ate), bs("bench_save.dat", std::ios::binary | std::ios::ate);
+    long long textBytes = ts.tellg(), binBytes = bs.tellg();
+    ts.close(); bs.close();
+    std::remove("bench_save.txt");
+    std::remove("bench_save.dat");
+    headless = saved;
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Inventory items: " << items << "\n";
+    std::cout << "save.txt  save " << std::setw(9) << textSave << " ms  load " << std::setw(9) << textLoad << " ms  " << textBytes << " bytes  round-trip " << (textOk ? "OK" : "FAIL") << "\n";
+    std::cout << "save.dat  save " << std::setw(9) << binSave << " ms  load " << std::setw(9) << binLoad << " ms  " << binBytes << " bytes  round-trip " << (binOk ? "OK" : "FAIL") << "\n";
+    std::cout << "save.dat  map + validate only " << std::setw(9) << viewOpen << " ms\n";
+    std::cout << std::defaultfloat;
+    return (textOk && binOk && sink) ? 0 : 1;
+}
+
+// rpg --inventory-bench: ns/op for add, find and remove at several sizes,
+// against the old vector-of-Item inventory (linear find, erase).
+int runInventoryBench() {
+    struct VectorInventory {
+        std::vector<Item> items;
+        void add(const Item& it) { items.push_back(it); }
+        int findByName(const std::string& n) const {
+            for (size_t i = 0; i < items.size(); ++i) if (items[i].name == n) return (int)i;
+            return -1;
+        }
+        void removeAt(int idx) { if (idx >= 0 && idx < (int)items.size()) items.erase(items.begin() + idx); }
+    };
+    rng.seed(99);
+    auto nsPer = [](std::chrono::steady_clock::time_point t0, long long ops) { return secondsSince(t0) * 1e9 / std::max(1LL, ops); };
+    volatile long long sink = 0;
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "   items |   add ns   find ns  remove ns  stack-add ns |  vec add   vec find  vec remove\n";
+    for (int n : { 10, 1000, 100000 }) {
+        std::vector<Item> items;
+        for (int i = 0; i < n; ++i) { Item it = Factory::sword(); it.name = "Sword #" + std::to_string(i); items.push_back(it); }
+        std::vector<int> order(n);
+        for (int i = 0; i < n; ++i) order[i] = i;
+        std::shuffle(order.begin(), order.end(), rng.gen);
+        const int probes = std::min(n, 2000);  // keeps the O(n) baseline finite at 100k
+
+        Inventory inv;
+        std::vector<Inventory::Handle> handles(n);
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; ++i) handles[i] = inv.add(items[i]);
+        double add = nsPer(t0, n);
+        t0 = std::chrono::steady_clock::now();
+        for (int i : order) sink = sink + inv.findByName(items[i].name);
+        double find = nsPer(t0, n);
+        t0 = std::chrono::steady_clock::now();
+        for (int i : order) inv.removeAt(inv.position(handles[i]));
+        double remove = nsPer(t0, n);
+        Inventory stacked;
+        const Item potion = Factory::potionSmall();
+        t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; ++i) stacked.add(potion);
+        double stackAdd = nsPer(t0, n);
+        sink = sink + (long long)inv.size() + stacked.count(0);
+
+        VectorInventory vec;
+        t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; ++i) vec.add(items[i]);
+        double vAdd = nsPer(t0, n);
+        t0 = std::chrono::steady_clock::now();
+        for (int k = 0; k < probes; ++k) sink = sink + vec.findByName(items[order[k]].name);
+        double vFind = nsPer(t0, probes);
+        t0 = std::chrono::steady_clock::now();
+        for (int k = 0; k < probes; ++k) vec.removeAt(rng.range(0, (int)vec.items.size() - 1));
+        double vRemove = nsPer(t0, probes);
+
+        std::cout << std::setw(8) << n << " |" << std::setw(9) << add << std::setw(10) << find << std::setw(11) << remove << std::setw(14) << stackAdd
+                  << " |" << std::setw(9) << vAdd << std::setw(11) << vFind << std::setw(12) << vRemove << "\n";
+    }
+    std::cout << std::defaultfloat;
+    return 0;
+}
+
+// rpg --batch [fights]: resolves fights in batches of 4096 concurrent lanes
+// and compares throughput and win rates with the scalar simulate() path.
+int runBatchBench(long long fights) {
+    rng.seed(12345);
+    fights = std::max(1LL, fights);
+    EnemyTable table;
+    auto protos = simPrototypes();
+    for (const auto& e : protos) table.add(e);
+    const Player hero = newHero();
+    const long long lanes = 4096;
+
+    std::cout << std::fixed << std::setprecision(1);
+    for (int id = 0; id < (int)table.kind.size(); ++id) {
+        CombatBatch batch;
+        SimResult r;
+        auto t0 = std::chrono::steady_clock::now();
+        for (long long done = 0; done < fights; done += lanes) {
+            batch.clear();
+            for (long long i = 0; i < std::min(lanes, fights - done); ++i) batch.add(hero, 2, table, id);
+            batch.run();
+            for (size_t i = 0; i < batch.size(); ++i) r.record(batch.won(i), batch.turns[i]);
+        }
+        double batchSecs = secondsSince(t0);
+        t0 = std::chrono::steady_clock::now();
+        SimResult s = simulate(protos[id], fights);
+        double scalarSecs = secondsSince(t0);
+        std::cout << std::left << std::setw(12) << table.name(id) << std::right
+                  << "  batch " << std::setw(11) << (batchSecs > 0 ? r.fights / batchSecs : 0.0) << " fights/sec, win "
+                  << std::setw(5) << (r.fights ? 100.0 * r.wins / r.fights : 0.0) << "%"
+                  << "  |  scalar " << std::setw(11) << (scalarSecs > 0 ? s.fights / scalarSecs : 0.0) << " fights/sec, win "
+                  << std::setw(5) << (s.fights ? 100.0 * s.wins / s.fights : 0.0) << "%\n";
+    }
+    std::cout << std::defaultfloat;
+    return 0;
+}
+
+// Totals for a batch of adventures. Every field is an integer sum, so merging
+// per-worker results gives the same answer in any order.
+struct AdventureStats {
+    long long adventures = 0;
+    long long survived = 0;
+    long long steps = 0;
+    long long gold = 0;
+    std::array<long long, 16> levelHist{};  // last bucket collects level 15+
+
+    void merge(const AdventureStats& o) {
+        adventures += o.adventures; survived += o.survived; steps += o.steps; gold += o.gold;
+        for (size_t i = 0; i < levelHist.size(); ++i) levelHist[i] += o.levelHist[i];
+    }
+};
+
+// One adventure: a fresh hero explores up to `steps` times, resting at the
+// inn when below half HP and moving to harder locations as they level.
+// The hero lives in the thread's EncounterArena, released when it ends.
+void runAdventure(const World& world, int steps, AdventureStats& out) {
+    static thread_local const Player hero = newHero();
+    {
+        Player p(encounterArena.resource());
+        p = hero;
+        int s = 0;
+        for (; s < steps && p.hp > 0; ++s) {
+            if (p.hp * 2 < p.maxHp && p.gold >= 10) { p.gold -= 10; p.hp = p.maxHp; }
+            explore(p, world[std::min((int)world.size() - 1, (p.level - 1) / 2)]);
+        }
+        out.adventures++;
+        out.survived += p.hp > 0;
+        out.steps += s;
+        out.gold += p.gold;
+        out.levelHist[std::min(p.level, (int)out.levelHist.size() - 1)]++;
+    }
+    encounterArena.reset();
+}
+
+// Work-stealing pool over a range of chunk indices. Each worker owns a
+// [begin, end) range packed into one atomic word: the owner takes chunks
+// from the front, idle workers steal the back half of a victim's range.
+class ChunkPool {
+public:
+    ChunkPool(unsigned workers, uint32_t chunks) : ranges(workers) {
+        for (unsigned w = 0; w < workers; ++w)
+            ranges[w].r.store(pack(chunks * w / workers, chunks * (w + 1) / workers));
+    }
+
+    // Next chunk for worker w, or false when every range is drained.
+    bool next(unsigned w, uint32_t& chunk) {
+        while (true) {
+            if (takeFront(w, chunk)) return true;
+            if (!steal(w)) return false;
+        }
+    }
+
+private:
+    struct alignas(64) Range { std::atomic<uint64_t> r{0}; };
+    std::vector<Range> ranges;
+
+    static uint64_t pack(uint32_t b, uint32_t e) { return ((uint64_t)b << 32) | e; }
+    static uint32_t begin(uint64_t v) { return (uint32_t)(v >> 32); }
+    static uint32_t end(uint64_t v) { return (uint32_t)v; }
+
+    bool takeFront(unsigned w, uint32_t& chunk) {
+        uint64_t v = ranges[w].r.load();
+        while (begin(v) < end(v)) {
+            if (ranges[w].r.compare_exchange_weak(v, pack(begin(v) + 1, end(v)))) { chunk = begin(v); return true; }
+        }
+        return false;
+    }
+
+    bool steal(unsigned w) {
+        for (size_t i = 1; i < ranges.size(); ++i) {
+            auto& victim = ranges[(w + i) % ranges.size()].r;
+            uint64_t v = victim.load();
+            while (begin(v) < end(v)) {
+                uint32_t mid = begin(v) + (end(v) - begin(v)) / 2;
+                if (victim.compare_exchange_weak(v, pack(begin(v), mid))) {
+                    ranges[w].r.store(pack(mid, end(v)));
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+};
+
+// Splits `adventures` into fixed chunks, each with its own seeded RNG stream,
+// so totals depend only on the seed, never on scheduling or thread count.
+AdventureStats runBalance(long long adventures, unsigned seed, unsigned threads) {
+    const long long chunkSize = 256;
+    const uint32_t chunks = (uint32_t)((adventures + chunkSize - 1) / chunkSize);
+    const auto world = buildWorld();
+    threads = std::max(1u, threads);
+    ChunkPool pool(threads, chunks);
+    struct alignas(64) Slot { AdventureStats stats; };
+    std::vector<Slot> results(threads);
+
+    auto worker = [&](unsigned w) {
+        headless.quiet = true;
+        headless.policy = scriptedPolicy;
+        uint32_t c;
+        while (pool.next(w, c)) {
+            rng.seedStream(seed, c);
+            long long first = (long long)c * chunkSize;
+            long long last = std::min(adventures, first + chunkSize);
+            for (long long i = first; i < last; ++i) runAdventure(world, 40, results[w].stats);
+        }
+    };
+    std::vector<std::thread> helpers;
+    for (unsigned w = 1; w < threads; ++w) helpers.emplace_back(worker, w);
+    worker(0);
+    for (auto& t : helpers) t.join();
+
+    AdventureStats total;
+    for (const auto& r : results) total.merge(r.stats);
+    return total;
+}
+
+// rpg --balance [adventures] [seed] [threads]
+int runBalanceCommand(long long adventures, unsigned seed, unsigned threads) {
+    Headless saved = headless;
+    auto t0 = std::chrono::steady_clock::now();
+    AdventureStats r = runBalance(adventures, seed, threads);
+    double secs = secondsSince(t0);
+    headless = saved;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << Color::bold << "\n== Balance run: " << r.adventures << " adventures, seed " << seed
+              << ", " << threads << " threads ==" << Color::reset << "\n";
+    std::cout << "Adventures/sec: " << (secs > 0 ? r.adventures / secs : 0.0) << "\n";
+    std::cout << "Survived 40 steps: " << 100.0 * r.survived / std::max(1LL, r.adventures) << "%"
+              << "  Avg steps: " << (double)r.steps / std::max(1LL, r.adventures)
+              << "  Avg gold: " << (double)r.gold / std::max(1LL, r.adventures) << "\n";
+    std::cout << "Final level:\n";
+    for (size_t l = 1; l < r.levelHist.size(); ++l) {
+        if (!r.levelHist[l]) continue;
+        std::cout << "  " << std::setw(3) << l << (l + 1 == r.levelHist.size() ? "+" : " ") << " | " << r.levelHist[l] << "\n";
+    }
+    std::cout << std::defaultfloat;
+    return 0;
+}
+
+// Weapon x armor advisor. Every pair drawn from the equipped gear, the
+// inventory and the shop is scored by the HP a plain-attack fight at a
+// location costs on average, weighted by its encounter mix. The model is
+// analytic and, for fights the player survives, exact: the expected rounds
+// to kill come from a recurrence over the enemy's HP using computeDamage()'s
+// roll distribution and crits, the enemy's mean hit is atk - def (4/3 at a
+// margin of 1, where the roll clamps), and explore()'s enemy scaling is
+// averaged out. --gear-bench checks the model against combat().
+namespace Gear {
+    struct Option {
+        Item item;
+        bool owned = false;  // equipped or in the inventory; otherwise bought at item.price
+    };
+
+    struct Pick {
+        uint32_t weapon = 0, armor = 0;  // indices into Advice::weapons / armors
+        double hpLost = 0;               // expected HP lost per fight
+        double rounds = 0;               // expected rounds per fight
+        int cost = 0;                    // gold for the pieces not owned
+    };
+
+    struct Advice {
+        std::vector<Option> weapons, armors;
+        std::vector<Pick> top;  // best first
+        Pick bestOwned;         // best pair needing no purchase
+        bool empty = true;      // no encounters at this location and level
+    };
+
+    constexpr size_t topCount = 5;
+
+    // E[computeDamage(atk, def)].
+    inline double meanDamage(int atk, int def) {
+        int d = std::max(1, atk - def);
+        return d == 1 ? 4.0 / 3.0 : d;
+    }
+
+    // rounds[h] = expected plain attacks to take an enemy from h HP to 0,
+    // for h in [0, maxHp]; each roll is doubled by a 15% crit.
+    void roundsToKill(int atk, int def, int maxHp, std::vector<double>& rounds) {
+        const int d = std::max(1, atk - def), v = std::max(1, d / 5);
+        const double p = 1.0 / (2 * v + 1);
+        rounds.assign(maxHp + 1, 0.0);
+        for (int h = 1; h <= maxHp; ++h) {
+            double r = 1;
+            for (int k = -v; k <= v; ++k) {
+                const int x = std::max(1, d + k);
+                r += p * (0.85 * rounds[std::max(0, h - x)] + 0.15 * rounds[std::max(0, h - 2 * x)]);
+            }
+            rounds[h] = r;
+        }
+    }
+
+    // Fewer HP lost, then cheaper, then catalog order: a total order, so the
+    // result does not depend on how the pairs were split across threads.
+    inline bool better(const Pick& a, const Pick& b) {
+        if (a.hpLost != b.hpLost) return a.hpLost < b.hpLost;
+        if (a.cost != b.cost) return a.cost < b.cost;
+        return a.weapon != b.weapon ? a.weapon < b.weapon : a.armor < b.armor;
+    }
+
+    inline void keepTop(std::vector<Pick>& top, const Pick& p) {
+        if (top.size() == topCount && !better(p, top.back())) return;
+        auto at = std::upper_bound(top.begin(), top.end(), p, better);
+        top.insert(at, p);
+        if (top.size() > topCount) top.pop_back();
+    }
+
+    // Equipped gear first, then inventory stacks, then shop stock the player
+    // does not already own.
+    void gather(const Player& p, std::vector<Option>& weapons, std::vector<Option>& armors) {
+        weapons.clear(); armors.clear();
+        weapons.push_back({ p.weapon, true });
+        armors.push_back({ p.armor, true });
+        for (size_t i = 0; i < p.inv.size(); ++i) {
+            const Item& it = p.inv.item(i);
+            if (it.type == ItemType::Weapon && !sameItem(it, p.weapon)) weapons.push_back({ it, true });
+            else if (it.type == ItemType::Armor && !sameItem(it, p.armor)) armors.push_back({ it, true });
+        }
+        const auto& pack = Content::pack();
+        for (size_t i = 0; i < pack.shopSize(); ++i) {
+            Item it = Content::makeItem(pack.shopItem(i));
+            if (it.type == ItemType::Weapon && !sameItem(it, p.weapon) && p.inv.find(it) < 0) weapons.push_back({ it, false });
+            else if (it.type == ItemType::Armor && !sameItem(it, p.armor) && p.inv.find(it) < 0) armors.push_back({ it, false });
+        }
+    }
+
+    // Scores every pair on `threads` workers. Per encounter, the enemy's
+    // expected turns depend only on the weapon and its mean hit only on the
+    // armor. They are independent, so a pair costs one multiply-add per
+    // encounter. Turns are memoized by attack value, which weapons share.
+    void evaluate(const Player& p, const Tables::Encounters& enc, Advice& a, unsigned threads) {
+        a.top.clear();
+        a.bestOwned = Pick{};
+        a.bestOwned.hpLost = -1;
+        a.empty = enc.empty();
+        if (a.empty) return;
+
+        const size_t W = a.weapons.size(), A = a.armors.size(), E = enc.enemies.size();
+        double total = 0;
+        for (uint32_t w : enc.weights) total += w;
+        std::vector<double> turns(W * E), hits(A * E), rounds;
+        std::unordered_map<int, double> byAttack;
+        for (size_t e = 0; e < E; ++e) {
+            const auto d = Content::enemy(enc.enemies[e]);
+            const double share = enc.weights[e] / total;
+            byAttack.clear();
+            for (size_t w = 0; w < W; ++w) {
+                const int atk = p.attack + a.weapons[w].item.power;
+                auto [it, fresh] = byAttack.try_emplace(atk, 0.0);
+                if (fresh) {
+                    double t = 0;
+                    for (int ds = 0; ds <= 2; ++ds) {
+                        roundsToKill(atk, d.defense + ds, d.hp + 6, rounds);
+                        for (int hs = 0; hs <= 6; ++hs) t += rounds[d.hp + hs] - 1;  // the killing round has no reply
+                    }
+                    it->second = share * t / 21;
+                }
+                turns[w * E + e] = it->second;
+            }
+            for (size_t r = 0; r < A; ++r) {
+                const int def = p.defense + a.armors[r].item.power;
+                double h = 0;
+                for (int as = 0; as <= 2; ++as) h += 0.8 * meanDamage(d.attack + as, def) + 0.2 * meanDamage(d.attack + as + 2, def);
+                hits[r * E + e] = h / 3;
+            }
+        }
+
+        struct alignas(64) Slot { std::vector<Pick> top; Pick owned; bool hasOwned = false; };
+        threads = std::max(1u, std::min<unsigned>(threads, (unsigned)W));
+        std::vector<Slot> slots(threads);
+        const uint32_t rowsPerChunk = (uint32_t)std::max<size_t>(1, 4096 / std::max<size_t>(1, A * E));
+        ChunkPool pool(threads, (uint32_t)((W + rowsPerChunk - 1) / rowsPerChunk));
+
+        auto worker = [&](unsigned t) {
+            Slot& s = slots[t];
+            uint32_t c;
+            while (pool.next(t, c)) {
+                const size_t last = std::min(W, (size_t)(c + 1) * rowsPerChunk);
+                for (size_t w = (size_t)c * rowsPerChunk; w < last; ++w) {
+                    const double* tw = &turns[w * E];
+                    double rounds = 0;
+                    for (size_t e = 0; e < E; ++e) rounds += tw[e];
+                    for (size_t r = 0; r < A; ++r) {
+                        const double* hr = &hits[r * E];
+                        double lost = 0;
+                        for (size_t e = 0; e < E; ++e) lost += tw[e] * hr[e];
+                        Pick pk{ (uint32_t)w, (uint32_t)r, lost, rounds + 1, 0 };
+                        if (!a.weapons[w].owned) pk.cost += a.weapons[w].item.price;
+                        if (!a.armors[r].owned) pk.cost += a.armors[r].item.price;
+                        keepTop(s.top, pk);
+                        if (pk.cost == 0 && (!s.hasOwned || better(pk, s.owned))) { s.owned = pk; s.hasOwned = true; }
+                    }
+                }
+            }
+        };
+        std::vector<std::thread> helpers;
+        for (unsigned t = 1; t < threads; ++t) helpers.emplace_back(worker, t);
+        worker(0);
+        for (auto& h : helpers) h.join();
+
+        for (const auto& s : slots) {
+            for (const auto& pk : s.top) keepTop(a.top, pk);
+            if (s.hasOwned && (a.bestOwned.hpLost < 0 || better(s.owned, a.bestOwned))) a.bestOwned = s.owned;
+        }
+    }
+
+    // Everything the advice depends on: content (and so shop stock),
+    // location, the encounter set, base stats, equipment and the inventory.
+    uint64_t key(const Player& p, const Location& loc, const Tables::Encounters& enc) {
+        int64_t k[] = { (int64_t)Content::generation, loc.index, enc.minLevel, enc.maxLevel, p.attack, p.defense,
+                        (int64_t)itemHash(p.weapon), (int64_t)itemHash(p.armor), (int64_t)p.inv.hash() };
+        return SessionLog::fnv1a(std::string_view((const char*)k, sizeof k));
+    }
+
+    struct Cache {
+        std::unordered_map<uint64_t, Advice> entries;
+        long long hits = 0, misses = 0;
+    };
+    thread_local Cache cache;
+
+    // Advice for p at loc; repeated queries for the same gear are cache hits.
+    const Advice& advise(const Player& p, const Location& loc, unsigned threads) {
+        const auto& enc = Tables::encounters(loc.index, p.level);
+        uint64_t k = key(p, loc, enc);
+        auto found = cache.entries.find(k);
+        if (found != cache.entries.end()) { cache.hits++; return found->second; }
+        cache.misses++;
+        if (cache.entries.size() >= 64) cache.entries.clear();
+        Advice& a = cache.entries[k];
+        gather(p, a.weapons, a.armors);
+        evaluate(p, enc, a, threads);
+        return a;
+    }
+}
+
+// Exact combat odds. combat() draws from a few bounded uniform rolls
+// (damage variance, 15% crits, 20% specials, 40% escapes), so a fight is a
+// finite Markov chain over (hero HP, enemy HP, potions drunk) and can be
+// solved instead of sampled. Each round the enemy survives costs the hero
+// HP unless a potion is drunk, so the chain has no cycles: potion layers
+// are solved last to first and hero HP upward within a layer, each state
+// once. Damage distributions are memoized per (attack, defense).
+namespace Odds {
+    struct Result {
+        double win = 0, loss = 0, fled = 0;
+        double turns = 0;   // expected rounds, as counted in headless.lastTurns
+        double hpLeft = 0;  // expected hero HP when the fight ends, 0 on a loss
+    };
+
+    using Policy = int (*)(const Player&, const Enemy&);
+
+    // (damage, probability), damage ascending.
+    using Dist = std::vector<std::pair<int, double>>;
+
+    enum Roll { Attack, Power, Reply, rollKinds };
+
+    // value[h, en]: the outcome from the start of a round. after[h, en]:
+    // the outcome from the enemy's reply on.
+    struct Layer { std::vector<Result> value, after; };
+
+    struct Memo {
+        std::array<std::unordered_map<uint64_t, Dist>, rollKinds> dists;
+        long long hits = 0, misses = 0;
+        Layer layers[2];  // reused, so warm calls allocate nothing
+    };
+    thread_local Memo memo;
+
+    // Adds weight * P(scale * computeDamage(atk, def) + bonus = x) for each x.
+    void addDamage(Dist& out, int atk, int def, double weight, int scale, int bonus) {
+        const int d = std::max(1, atk - def), v = std::max(1, d / 5);
+        const double p = weight / (2 * v + 1);
+        for (int k = -v; k <= v; ++k) out.push_back({ scale * std::max(1, d + k) + bonus, p });
+    }
+
+    // Attack: a 15% crit doubles the roll. Power: computeDamage(atk + 5)
+    // + 5, never a crit. Reply: the enemy's hit, +2 attack on a 20% special.
+    const Dist& dist(Roll r, int atk, int def) {
+        const uint64_t k = ((uint64_t)(uint32_t)atk << 32) | (uint32_t)def;
+        auto [it, fresh] = memo.dists[r].try_emplace(k);
+        if (!fresh) { memo.hits++; return it->second; }
+        memo.misses++;
+        Dist& out = it->second;
+        if (r == Attack) { addDamage(out, atk, def, 0.85, 1, 0); addDamage(out, atk, def, 0.15, 2, 0); }
+        else if (r == Power) addDamage(out, atk + 5, def, 1.0, 1, 5);
+        else { addDamage(out, atk, def, 0.8, 1, 0); addDamage(out, atk + 2, def, 0.2, 1, 0); }
+        std::sort(out.begin(), out.end());
+        size_t n = 0;
+        for (const auto& [x, p] : out) {
+            if (n > 0 && out[n - 1].first == x) out[n - 1].second += p;
+            else out[n++] = { x, p };
+        }
+        out.resize(n);
+        return out;
+    }
+
+    // Heal amounts in the order the headless "use item" action drinks them:
+    // always the first consumable stack, and an emptied stack is replaced
+    // by the last one, as Inventory::removeAt does.
+    std::vector<int> potionOrder(const Inventory& inv) {
+        struct S { bool consumable; int heal, count; };
+        std::vector<S> s;
+        for (size_t i = 0; i < inv.size(); ++i) s.push_back({ inv.item(i).type == ItemType::Consumable, inv.item(i).healAmount, inv.count(i) });
+        std::vector<int> heals;
+        while (true) {
+            size_t i = 0;
+            while (i < s.size() && !s[i].consumable) ++i;
+            if (i == s.size()) return heals;
+            heals.push_back(s[i].heal);
+            if (--s[i].count == 0) { s[i] = s.back(); s.pop_back(); }
+        }
+    }
+
+    // The outcome of combat(p, e) with `policy` choosing the hero's actions.
+    // The policy is asked with the hero's and enemy's current HP; the hero
+    // it sees carries the full inventory while any potion is left and an
+    // empty one after, which is all scriptedPolicy() looks at.
+    Result evaluate(const Player& p, const Enemy& e, Policy policy) {
+        Result r;
+        if (p.hp <= 0) { r.loss = 1; return r; }
+        if (e.hp <= 0) { r.win = 1; r.hpLeft = p.hp; return r; }
+        for (auto& m : memo.dists) if (m.size() >= 4096) m.clear();
+        const Dist& hit = dist(Attack, p.atk(), e.defense);
+        const Dist& power = dist(Power, p.atk(), e.defense);
+        const Dist& reply = dist(Reply, e.attack, p.def());
+        const std::vector<int> heals = potionOrder(p.inv);
+        const size_t K = heals.size();
+        const int H = std::max(p.hp, p.maxHp), E = e.hp;
+
+        Player stocked = p, dry = p;
+        dry.inv.clear();
+        Enemy foe = e;
+        // The reply only costs HP, so after[h] needs value below h, and a
+        // round is one pass over the hero's move: |hit| + |reply| terms,
+        // not the product. Every state is written before it is read, so
+        // the buffers are not cleared. cur is the layer being solved, next
+        // the one after another potion.
+        const size_t states = (size_t)(H + 1) * (E + 1);
+        Layer* cur = &memo.layers[0];
+        Layer* next = &memo.layers[1];
+        for (Layer* l : { cur, next }) {
+            if (l->value.size() < states) { l->value.resize(states); l->after.resize(states); }
+        }
+        auto at = [E](int h, int en) { return (size_t)h * (E + 1) + en; };
+        auto add = [](Result& v, double w, const Result& s) {
+            v.win += w * s.win; v.loss += w * s.loss; v.fled += w * s.fled;
+            v.turns += w * s.turns; v.hpLeft += w * s.hpLeft;
+        };
+
+        for (size_t k = K + 1; k-- > 0;) {
+            Player& hero = k < K ? stocked : dry;
+            // Without potions left the hero's HP never rises, so the first
+            // layer needs no row above the starting HP.
+            const int top = k == 0 ? p.hp : H;
+            for (int h = 1; h <= top; ++h) {
+                for (int en = 1; en <= E; ++en) {
+                    Result& r = cur->after[at(h, en)];
+                    r = Result{};
+                    for (const auto& [d, q] : reply) {
+                        if (h <= d) r.loss += q;
+                        else add(r, q, cur->value[at(h - d, en)]);
+                    }
+                }
+                hero.hp = h;
+                for (int en = 1; en <= E; ++en) {
+                    foe.hp = en;
+                    Result v;
+                    auto strike = [&](const Dist& dmg, int h1) {
+                        for (const auto& [d, q] : dmg) {
+                            if (en <= d) { v.win += q; v.hpLeft += q * h1; }
+                            else add(v, q, cur->after[at(h1, en - d)]);
+                        }
+                    };
+                    const int action = policy(hero, foe);
+                    if (action == 1) strike(hit, h);
+                    else if (action == 2 && h > 10) strike(power, h - 10);
+                    else if (action == 3 && k < K) add(v, 1, next->after[at(clamp(h + heals[k], 0, p.maxHp), en)]);
+                    else if (action == 4) { v.fled += 0.4; v.hpLeft += 0.4 * h; add(v, 0.6, cur->after[at(h, en)]); }
+                    else add(v, 1, cur->after[at(h, en)]);
+                    v.turns += 1;
+                    cur->value[at(h, en)] = v;
+                }
+            }
+            std::swap(cur, next);
+        }
+        return next->value[at(p.hp, e.hp)];
+    }
+}
+
+// Evolutionary balance tuner. A candidate is every enemy's hp, attack,
+// defense, xp and gold plus the prices of the items in priceTargets. Its
+// score is the squared miss against the targets below, measured by
+// simulated fights at each target's location, plus a small pull back
+// toward the starting values. Fights use one fixed RNG stream per target,
+// so a candidate's score is a pure function of its parameters: it is
+// memoized on their hash, and candidates are compared on the same dice.
+namespace Tuner {
+    // How a tuned pack should play. A hero of `level` with the given gear
+    // (ItemId::None: the starting gear) should win `winRate` of the fights
+    // at `location` and earn goldPerWin per win, and level up after
+    // winsPerLevel wins.
+    struct WinTarget { uint32_t location; int level; ItemId weapon, armor; double winRate, goldPerWin, winsPerLevel; };
+    constexpr WinTarget winTargets[] = {
+        { 0, 1, ItemId::None,  ItemId::None, 0.80, 10, 2.5 },
+        { 1, 2, ItemId::None,  ItemId::None, 0.75, 22, 3.0 },
+        { 2, 3, ItemId::Sword, ItemId::None, 0.65, 40, 3.5 },
+    };
+
+    // An item should cost `wins` wins at the location of winTargets[target].
+    struct PriceTarget { ItemId item; size_t target; double wins; };
+    constexpr PriceTarget priceTargets[] = {
+        { ItemId::PotionSmall, 0, 1.0 }, { ItemId::Sword,      0, 4.0 }, { ItemId::Leather, 0, 3.5 },
+        { ItemId::PotionLarge, 1, 1.2 }, { ItemId::Greatsword, 1, 4.0 }, { ItemId::Plate,   1, 5.0 },
+    };
+
+    constexpr int statsPerEnemy = 5;  // hp, attack, defense, xp, gold
+    constexpr double winTolerance = 0.02, rewardTolerance = 0.10, anchorWeight = 0.5;
+
+    using Params = std::vector<int>;
+
+    struct Measured { double winRate = 0, goldPerWin = 0, xpPerWin = 0; };
+
+    struct Score {
+        double total = 0;
+        std::array<Measured, std::size(winTargets)> at{};
+    };
+
+    size_t enemyCount() { return Content::pack().enemyCount(); }
+
+    Params fromContent() {
+        Params x;
+        for (size_t i = 0; i < enemyCount(); ++i) {
+            const auto d = Content::enemy((EnemyId)i);
+            x.insert(x.end(), { d.hp, d.attack, d.defense, d.xpReward, d.goldReward });
+        }
+        for (const auto& t : priceTargets) x.push_back(Content::item(t.item).price);
+        return x;
+    }
+
+    int lowerBound(size_t i) {
+        return i < enemyCount() * statsPerEnemy && i % statsPerEnemy == 2 ? 0 : 1;  // defense may be 0
+    }
+
+    bool active(const WinTarget& t) { return t.location < Content::pack().locationCount(); }
+
+    // `fights` fights per target with candidate x, hero reset each time.
+    Score evaluate(const Params& x, const Params& anchor, long long fights, uint64_t seed) {
+        Score s;
+        headless.quiet = true;
+        headless.policy = scriptedPolicy;
+        for (size_t t = 0; t < std::size(winTargets); ++t) {
+            const WinTarget& target = winTargets[t];
+            if (!active(target)) continue;
+            Player hero = newHero();
+            while (hero.level < target.level) Progression::grant(hero, Progression::curve.need(hero.level));
+            if (target.weapon != ItemId::None) hero.weapon = Content::makeItem(target.weapon);
+            if (target.armor != ItemId::None) hero.armor = Content::makeItem(target.armor);
+            const auto& enc = Tables::encounters(target.location, hero.level);
+            if (enc.empty()) continue;
+            rng.seedStream(seed, t);
+            Player h = hero;
+            long long wins = 0, gold = 0, xp = 0;
+            for (long long f = 0; f < fights; ++f) {
+                h.level = hero.level; h.xp = 0; h.maxHp = h.hp = hero.maxHp; h.attack = hero.attack; h.defense = hero.defense;
+                h.inv.clear();
+                h.inv.add(ItemId::PotionSmall, 2);
+                Enemy e = spawnEnemy(enc.sample());
+                const int* st = &x[(size_t)e.id * statsPerEnemy];
+                e.maxHp = st[0]; e.attack = st[1]; e.defense = st[2]; e.xpReward = st[3]; e.goldReward = st[4];
+                e.attack += rng.range(0, 2);
+                e.defense += rng.range(0, 2);
+                e.maxHp += rng.range(0, 6); e.hp = e.maxHp;
+                if (combat(h, e)) { wins++; gold += e.goldReward; xp += e.xpReward; }
+            }
+            Measured& m = s.at[t];
+            m.winRate = (double)wins / std::max(1LL, fights);
+            m.goldPerWin = wins ? (double)gold / wins : 0;
+            m.xpPerWin = wins ? (double)xp / wins : 0;
+            const double xpTarget = Progression::curve.need(target.level) / target.winsPerLevel;
+            auto sq = [](double v) { return v * v; };
+            s.total += sq((m.winRate - target.winRate) / winTolerance)
+                     + sq((m.goldPerWin / target.goldPerWin - 1) / rewardTolerance)
+                     + sq((m.xpPerWin / xpTarget - 1) / rewardTolerance);
+        }
+        const size_t prices = enemyCount() * statsPerEnemy;
+        for (size_t i = 0; i < std::size(priceTargets); ++i) {
+            const PriceTarget& p = priceTargets[i];
+            if (!active(winTargets[p.target])) continue;
+            const double want = s.at[p.target].goldPerWin * p.wins;
+            if (want > 0) s.total += std::pow((x[prices + i] / want - 1) / rewardTolerance, 2);
+        }
+        for (size_t i = 0; i < x.size(); ++i) s.total += anchorWeight * std::pow((double)(x[i] - anchor[i]) / std::max(1, anchor[i]), 2);
+        return s;
+    }
+
+    uint64_t hash(const Params& x) { return SessionLog::fnv1a(std::string_view((const char*)x.data(), x.size() * sizeof(int))); }
+
+    // Standard normal draw (Box-Muller).
+    double gaussian(RNG& r) {
+        double u = (Rand::bits32(r.gen) + 1.0) / 4294967297.0, v = Rand::bits32(r.gen) / 4294967296.0;
+        return std::sqrt(-2 * std::log(u)) * std::cos(6.283185307179586 * v);
+    }
+
+    struct Result {
+        Params best;
+        Score start, score;
+        long long evaluations = 0, memoHits = 0, fights = 0;
+    };
+
+    // (mu + lambda) evolution strategy: each child mutates about a quarter
+    // of a random parent's parameters by relative Gaussian steps (at least
+    // 1, since parameters are integers), the best `population / 4` of parents and
+    // children survive, and the step grows or shrinks with the success
+    // rate (the 1/5 rule). Uncached candidates of a generation are scored
+    // in parallel on the work-stealing pool.
+    Result tune(int generations, int population, long long fights, uint64_t seed, unsigned threads, bool verbose) {
+        const Params anchor = fromContent();
+        std::unordered_map<uint64_t, Score> memo;
+        Result r;
+        threads = std::max(1u, threads);
+        auto score = [&](std::vector<Params>& xs) {
+            std::vector<Score> out(xs.size());
+            std::vector<uint32_t> todo;
+            for (size_t i = 0; i < xs.size(); ++i) {
+                auto found = memo.find(hash(xs[i]));
+                if (found != memo.end()) { out[i] = found->second; r.memoHits++; }
+                else todo.push_back((uint32_t)i);
+            }
+            ChunkPool pool(threads, (uint32_t)todo.size());
+            auto worker = [&](unsigned w) {
+                Headless saved = headless;
+                uint32_t c;
+                while (pool.next(w, c)) out[todo[c]] = evaluate(xs[todo[c]], anchor, fights, seed);
+                headless = saved;
+            };
+            std::vector<std::thread> helpers;
+            for (unsigned w = 1; w < threads && w < todo.size(); ++w) helpers.emplace_back(worker, w);
+            worker(0);
+            for (auto& h : helpers) h.join();
+            for (uint32_t i : todo) { memo.emplace(hash(xs[i]), out[i]); r.evaluations++; }
+            return out;
+        };
+
+        const int mu = std::max(1, population / 4);
+        std::vector<Params> parents{ anchor };
+        std::vector<Score> parentScores = score(parents);
+        r.start = parentScores[0];
+        double sigma = 0.2;
+        RNG search(seed);  // apart from rng, which evaluate() reseeds on this thread too
+        search.seedStream(seed, ~0ULL);
+        for (int g = 0; g < generations; ++g) {
+            std::vector<Params> children(population);
+            std::vector<size_t> parentOf(population);
+            for (int c = 0; c < population; ++c) {
+                parentOf[c] = Rand::below(search.gen, (uint32_t)parents.size());
+                children[c] = parents[parentOf[c]];
+                // A few parameters per child, each by at least 1.
+                Params& x = children[c];
+                size_t first = Rand::below(search.gen, (uint32_t)x.size());
+                for (size_t i = 0; i < x.size(); ++i) {
+                    if (i != first && !search.chance(25)) continue;
+                    double step = sigma * std::max(4, x[i]) * gaussian(search);
+                    int delta = (int)std::lround(step);
+                    if (delta == 0) delta = step < 0 ? -1 : 1;
+                    x[i] = std::max(lowerBound(i), x[i] + delta);
+                }
+            }
+            std::vector<Score> childScores = score(children);
+            int improved = 0;
+            for (int c = 0; c < population; ++c) improved += childScores[c].total < parentScores[parentOf[c]].total;
+            sigma = std::clamp(improved * 5 > population ? sigma * 1.2 : sigma * 0.85, 0.02, 0.5);
+
+            std::vector<std::pair<Params, Score>> pool;
+            for (size_t i = 0; i < parents.size(); ++i) pool.emplace_back(std::move(parents[i]), parentScores[i]);
+            for (int c = 0; c < population; ++c) pool.emplace_back(std::move(children[c]), childScores[c]);
+            std::stable_sort(pool.begin(), pool.end(), [](const auto& a, const auto& b) { return a.second.total < b.second.total; });
+            parents.clear(); parentScores.clear();
+            for (auto& [x, s] : pool) {
+                if ((int)parents.size() == mu) break;
+                if (std::find(parents.begin(), parents.end(), x) != parents.end()) continue;
+                parents.push_back(std::move(x));
+                parentScores.push_back(s);
+            }
+            if (verbose)
+                std::cout << "  gen " << std::setw(3) << g + 1 << "  best " << std::fixed << std::setprecision(2) << std::setw(9) << parentScores[0].total
+                          << "  step " << std::setprecision(3) << sigma << "  evaluated " << r.evaluations << ", memo hits " << r.memoHits << std::defaultfloat << "\n";
+        }
+        r.best = parents[0];
+        r.score = parentScores[0];
+        size_t activeTargets = 0;
+        for (const auto& t : winTargets) activeTargets += active(t);
+        r.fights = r.evaluations * fights * (long long)activeTargets;
+        return r;
+    }
+
+    // The active pack with x applied, as a text pack.
+    std::string packText(const Params& x) {
+        std::vector<std::array<int32_t, 5>> enemies(enemyCount());
+        for (size_t i = 0; i < enemies.size(); ++i)
+            for (int k = 0; k < statsPerEnemy; ++k) enemies[i][k] = x[i * statsPerEnemy + k];
+        std::vector<int32_t> prices(Content::pack().itemCount());
+        for (size_t i = 0; i < prices.size(); ++i) prices[i] = Content::item((ItemId)i).price;
+        for (size_t i = 0; i < std::size(priceTargets); ++i) prices[(size_t)priceTargets[i].item] = x[enemies.size() * statsPerEnemy + i];
+        ContentPack::Loaded tuned;
+        tuned.image = ContentPack::restat(Content::active.bytes(), enemies, prices);
+        tuned.open();
+        return ContentPack::exportText(tuned.view);
+    }
+}
+
+// rpg --alloc-report [ops]: global allocations per operation once the
+// player's inventory already holds every catalog item. Exits non-zero if
+// a steady-state shop purchase, loot drop, explore step, simulated fight
+// or adventure allocates.
+int runAllocReport(long long ops) {
+    ops = std::max(1LL, ops);
+    Headless saved = headless;
+    headless.quiet = true;
+    headless.policy = scriptedPolicy;
+    rng.seed(5);
+    const auto world = buildWorld();
+    Player p = newHero();
+    for (size_t i = 0; i < (size_t)ItemId::Count; ++i) p.inv.add((ItemId)i);
+
+    struct Row { const char* what; long long news; };
+    std::vector<Row> rows;
+    rows.reserve(8);
+    auto measure = [&](const char* what, auto&& fn) {
+        for (int i = 0; i < 1000; ++i) fn();  // first use builds the encounter, drop and event tables
+        long long before = AllocStats::news;
+        for (long long i = 0; i < ops; ++i) fn();
+        rows.push_back({ what, AllocStats::news - before });
+    };
+    headless.policy = scriptedPolicy;  // simulate() restores headless on return
+    const int stock = (int)Content::pack().shopSize();
+    measure("shop purchase", [&] { p.gold = 1000; if (stock) buyItem(p, Content::pack().shopItem(rng.range(0, stock - 1))); });
+    measure("giveLoot", [&] { Enemy e = spawnEnemy((EnemyId)rng.range(0, (int)EnemyId::Count - 1)); giveLoot(p, e); p.level = 1; });
+    measure("explore step", [&] { p.hp = p.maxHp; explore(p, world[rng.range(0, (int)world.size() - 1)]); });
+
+    // Fight loops: warm up once so the thread's hero template exists, then
+    // every fight or adventure must stay inside the EncounterArena.
+    const Enemy wolf = spawnEnemy(EnemyId::Wolf);
+    simulate(wolf, 1);
+    measure("simulated fight", [&] { simulate(wolf, 1); });
+    AdventureStats adv;
+    runAdventure(world, 40, adv);
+    measure("adventure", [&] { runAdventure(world, 40, adv); });
+    long long legacyBefore = AllocStats::news;
+    for (long long i = 0; i < ops; ++i) {
+        std::vector<Item> stock = { Factory::potionSmall(), Factory::potionLarge(), Factory::sword(), Factory::leather(), Factory::greatsword(), Factory::plate() };
+    }
+    long long legacy = AllocStats::news - legacyBefore;
+    headless = saved;
+
+    bool ok = true;
+    std::cout << std::fixed << std::setprecision(3);
+    for (const auto& r : rows) {
+        ok &= r.news == 0;
+        std::cout << std::left << std::setw(16) << r.what << std::right << std::setw(10) << (double)r.news / ops << " allocs/op  " << (r.news ? "FAIL" : "PASS") << "\n";
+    }
+    std::cout << std::left << std::setw(16) << "old shop stock" << std::right << std::setw(10) << (double)legacy / ops << " allocs/op  (per-visit vector rebuild)\n";
+    std::cout << std::defaultfloat;
+    return ok ? 0 : 1;
+}
+
+// rpg --render-bench [frames]: builds the status, shop, combat and
+// inventory screens and presents them to the null device, reporting bytes
+// and write calls per frame against writing the same text line by line.
+int runRenderBench(long long frames) {
+    frames = std::max(1LL, frames);
+#ifdef _WIN32
+    HANDLE sink = CreateFileA("NUL", GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+#else
+    int sink = ::open("/dev/null", O_WRONLY);
+#endif
+    Player p = newHero();
+    p.inv.add(ItemId::Sword);
+    Enemy e = spawnEnemy(EnemyId::Bandit);
+    Frame saved;
+    std::swap(saved, screen);
+    screen.setOutput(sink);
+    auto buildScreens = [&] {
+        screen.clearScreen();
+        showPlayer(p);
+        renderShop(p);
+        renderCombatStatus(p, e);
+        p.inv.list();
+    };
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (long long i = 0; i < frames; ++i) { buildScreens(); screen.present(); }
+    double frameSecs = secondsSince(t0);
+    const Frame framed = screen;
+
+    Frame lines;
+    lines.setOutput(sink);
+    t0 = std::chrono::steady_clock::now();
+    for (long long i = 0; i < frames; ++i) {
+        buildScreens();
+        std::string_view text = screen.pending();
+        for (size_t start = 0; start < text.size();) {
+            size_t end = text.find('\n', start);
+            end = end == std::string_view::npos ? text.size() : end + 1;
+            lines << text.substr(start, end - start);
+            lines.present();
+            start = end;
+        }
+        screen.discard();
+    }
+    double lineSecs = secondsSince(t0);
+    std::swap(saved, screen);
+#ifdef _WIN32
+    CloseHandle(sink);
+#else
+    ::close(sink);
+#endif
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Per frame: " << (double)framed.bytes / frames << " bytes, " << (double)framed.writes / frames << " writes, "
+              << frames / frameSecs << " frames/sec\n";
+    std::cout << "Per line:  " << (double)lines.bytes / frames << " bytes, " << (double)lines.writes / frames << " writes, "
+              << frames / lineSecs << " frames/sec\n" << std::defaultfloat;
+    return 0;
+}
+
+bool writeFile(const std::string& path, std::string_view data) {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    f.write(data.data(), (std::streamsize)data.size());
+    return (bool)f;
+}
+
+// rpg --pack-compile <in> <out>: text (or binary) pack to binary.
+int runPackCompile(const std::string& in, const std::string& out) {
+    ContentPack::Loaded pack;
+    std::string error;
+    if (!ContentPack::load(in, pack, error)) { std::cerr << error << "\n"; return 1; }
+    if (!writeFile(out, pack.bytes())) { std::cerr << "cannot write " << out << "\n"; return 1; }
+    std::cout << out << ": " << pack.view.itemCount() << " items, " << pack.view.enemyCount() << " enemies, "
+              << pack.view.locationCount() << " locations, " << pack.view.shopSize() << " shop items, " << pack.bytes().size() << " bytes\n";
+    return 0;
+}
+
+// rpg --pack-export <out>: the active content as an editable text pack.
+int runPackExport(const std::string& out) {
+    if (!writeFile(out, ContentPack::exportText(Content::pack()))) { std::cerr << "cannot write " << out << "\n"; return 1; }
+    std::cout << "Wrote " << out << "\n";
+    return 0;
+}
+
+// rpg --tune [generations] [population] [fights] [seed] [out]: tunes the
+// active content toward Tuner's targets and writes the result as a text
+// pack, loadable with --content.
+int runTuneCommand(int generations, int population, long long fights, uint64_t seed, const std::string& out) {
+    const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << Color::bold << "\n== Tuning: " << generations << " generations of " << population << ", " << fights
+              << " fights per target, seed " << seed << ", " << threads << " threads ==" << Color::reset << "\n";
+    auto t0 = std::chrono::steady_clock::now();
+    Tuner::Result r = Tuner::tune(generations, population, fights, seed, threads, true);
+    double secs = secondsSince(t0);
+    std::cout << std::fixed << std::setprecision(0) << r.evaluations << " candidates simulated (" << r.memoHits << " memo hits), "
+              << r.fights / std::max(secs, 1e-9) << " fights/sec, " << std::setprecision(1) << secs << " s\n";
+
+    const Tuner::Params start = Tuner::fromContent();
+    std::cout << "Score " << std::setprecision(2) << r.start.total << " -> " << r.score.total << "\n";
+    std::cout << std::setw(22) << "win % (target)" << std::setw(22) << "gold/win" << std::setw(22) << "xp/win" << "   hero at\n";
+    for (size_t t = 0; t < std::size(Tuner::winTargets); ++t) {
+        const auto& w = Tuner::winTargets[t];
+        if (!Tuner::active(w)) continue;
+        const auto &a = r.start.at[t], &b = r.score.at[t];
+        auto cell = [](double from, double to, double want) {
+            std::ostringstream ss;
+            ss << std::fixed << std::setprecision(1) << from << " -> " << to << " (" << want << ")";
+            return ss.str();
+        };
+        std::cout << std::setw(22) << cell(100 * a.winRate, 100 * b.winRate, 100 * w.winRate)
+                  << std::setw(22) << cell(a.goldPerWin, b.goldPerWin, w.goldPerWin)
+                  << std::setw(22) << cell(a.xpPerWin, b.xpPerWin, Progression::curve.need(w.level) / w.winsPerLevel)
+                  << "   L" << w.level << " " << Content::pack().str(Content::pack().location(w.location).name) << "\n";
+    }
+    constexpr const char* names[] = { "hp", "atk", "def", "xp", "gold" };
+    static_assert(std::size(names) == Tuner::statsPerEnemy);
+    for (size_t i = 0; i < Tuner::enemyCount(); ++i) {
+        std::cout << "  " << std::left << std::setw(14) << Content::enemy((EnemyId)i).name << std::right;
+        for (int k = 0; k < Tuner::statsPerEnemy; ++k) {
+            size_t at = i * Tuner::statsPerEnemy + k;
+            std::cout << "  " << names[k] << " " << start[at] << "->" << r.best[at];
+        }
+        std::cout << "\n";
+    }
+    for (size_t i = 0; i < std::size(Tuner::priceTargets); ++i) {
+        size_t at = Tuner::enemyCount() * Tuner::statsPerEnemy + i;
+        std::cout << "  " << std::left << std::setw(14) << Content::item(Tuner::priceTargets[i].item).name << std::right << "  $" << start[at] << "->$" << r.best[at] << "\n";
+    }
+    std::cout << std::defaultfloat;
+    if (!writeFile(out, Tuner::packText(r.best))) { std::cerr << "cannot write " << out << "\n"; return 1; }
+    std::cout << "Wrote " << out << " (play it with: rpg --content " << out << ")\n";
+    return 0;
+}
+
+// Best-effort drop of a file from the OS page cache, so the next open is a
+// cold read from disk. No-op where the platform offers no such hint.
+void evictFromCache(const std::string& path) {
+#if !defined(_WIN32) && defined(POSIX_FADV_DONTNEED)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    fsync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+#else
+    (void)path;
+#endif
+}
+
+// The built-in content plus `extra` generated items and enemies and
+// extra / 10 generated locations.
+std::string syntheticPackText(long long extra) {
+    std::string text = ContentPack::exportText(ContentPack::builtin().view);
+    for (long long i = 0; i < extra; ++i) {
+        std::string n = std::to_string(i);
+        text += "item|gen_item" + n + "|Generated Item " + n + "|weapon|" + std::to_string(i % 20) + "|0|" + std::to_string(10 + i % 500) + "\n";
+    }
+    for (long long i = 0; i < extra; ++i) {
+        std::string n = std::to_string(i);
+        text += "enemy|gen_enemy" + n + "|Generated Enemy " + n + "|" + std::to_string(1 + i % 20) + "|" + std::to_string(20 + i % 80) + "|"
+              + std::to_string(4 + i % 15) + "|" + std::to_string(1 + i % 8) + "|" + std::to_string(10 + i % 40) + "|"
+              + std::to_string(5 + i % 50) + "|gen_item" + n + ":1,-:1\n";
+    }
+    for (long long i = 0; i < extra / 10; ++i)
+        text += "location|Generated Location " + std::to_string(i) + "|gen_enemy" + std::to_string(i * 10) + ":3,gen_enemy"
+              + std::to_string(i * 10 + 1) + ":1@3-,slime:1@-5\n";
+    return text;
+}
+
+// rpg --pack-bench [entries]: startup cost of loading a content pack as it
+// grows, from text (parsed and compiled at startup) and from a binary image
+// (mapped, header checked, first records read). Cold loads start with the
+// file evicted from the page cache where the OS allows it, so the binary
+// cold time is the few page-ins the first reads need; warm loads show the
+// in-memory cost.
+int runPackBench(long long maxEntries) {
+    maxEntries = std::max(100LL, maxEntries);  // the smallest row
+    const std::string textPath = "pack_bench.txt", binPath = "pack_bench.bin";
+    // Touches the last record of each table, as the first frame of a game would.
+    auto firstUse = [](const ContentPack::View& v) {
+        return std::strlen(v.item((ItemId)(v.itemCount() - 1)).name) + std::strlen(v.enemy((EnemyId)(v.enemyCount() - 1)).name)
+             + std::strlen(v.str(v.location(v.locationCount() - 1).name));
+    };
+    auto median = [](std::vector<double> v) { std::sort(v.begin(), v.end()); return v[v.size() / 2]; };
+    size_t sink = 0;
+
+    std::cout << std::setw(9) << "entries" << std::setw(11) << "text KB" << std::setw(11) << "binary KB"
+              << std::setw(14) << "text cold ms" << std::setw(16) << "binary cold ms" << std::setw(16) << "binary warm ms" << "\n";
+    std::cout << std::fixed;
+    for (long long n = 100; n <= maxEntries; n *= 10) {
+        const std::string text = syntheticPackText(n);
+        ContentPack::Loaded compiled;
+        std::string error;
+        if (!ContentPack::compileText(text, compiled.image, error) || !compiled.open()) { std::cerr << error << "\n"; return 1; }
+        if (!writeFile(textPath, text) || !writeFile(binPath, compiled.image)) { std::cerr << "cannot write bench files\n"; return 1; }
+
+        auto load = [&](const std::string& path, int runs, bool cold) {
+            std::vector<double> ms;
+            for (int r = 0; r < runs; ++r) {
+                if (cold) evictFromCache(path);
+                auto t0 = std::chrono::steady_clock::now();
+                ContentPack::Loaded pack;
+                if (!ContentPack::load(path, pack, error)) { std::cerr << error << "\n"; return -1.0; }
+                sink += firstUse(pack.view);
+                ms.push_back(secondsSince(t0) * 1000);
+            }
+            return median(ms);
+        };
+        double textMs = load(textPath, 3, true), coldMs = load(binPath, 9, true), warmMs = load(binPath, 9, false);
+        if (textMs < 0 || coldMs < 0 || warmMs < 0) return 1;
+        std::cout << std::setw(9) << 2 * n + n / 10 << std::setprecision(1) << std::setw(11) << text.size() / 1024.0
+                  << std::setw(11) << compiled.image.size() / 1024.0 << std::setprecision(3) << std::setw(14) << textMs
+                  << std::setw(16) << coldMs << std::setw(16) << warmMs << "\n";
+    }
+    std::cout << std::defaultfloat;
+    std::remove(textPath.c_str());
+    std::remove(binPath.c_str());
+    return sink ? 0 : 1;
+}
+
+// Linear cumulative scan over weights, the baseline for --alias-bench.
+uint32_t linearPick(const std::vector<uint32_t>& weights, uint64_t total, RNG& r) {
+    uint64_t roll = ((uint64_t)Rand::bits32(r.gen) * total) >> 32;
+    uint32_t i = 0;
+    for (; i + 1 < weights.size(); ++i) {
+        if (roll < weights[i]) break;
+        roll -= weights[i];
+    }
+    return i;
+}
+
+// rpg --alias-bench [samples]: samples/sec for AliasTable against a linear
+// cumulative scan over the same random weights, for growing table sizes.
+int runAliasBench(long long samples) {
+    samples = std::max(1000LL, samples);
+    RNG r(99);
+    uint64_t sink = 0;
+    std::cout << std::setw(8) << "entries" << std::setw(14) << "build us" << std::setw(18) << "alias samples/s"
+              << std::setw(18) << "linear samples/s" << std::setw(10) << "speedup" << "\n" << std::fixed;
+    for (size_t n : { 4, 16, 64, 256, 1024, 4096 }) {
+        std::vector<uint32_t> weights(n);
+        uint64_t total = 0;
+        for (auto& w : weights) total += w = (uint32_t)r.range(1, 1000);
+        AliasTable table;
+        auto t0 = std::chrono::steady_clock::now();
+        const int builds = 100;
+        for (int b = 0; b < builds; ++b) table.build(weights);
+        double buildUs = secondsSince(t0) * 1e6 / builds;
+
+        t0 = std::chrono::steady_clock::now();
+        for (long long i = 0; i < samples; ++i) sink += table.sample(r);
+        double aliasSecs = secondsSince(t0);
+        t0 = std::chrono::steady_clock::now();
+        for (long long i = 0; i < samples; ++i) sink += linearPick(weights, total, r);
+        double linearSecs = secondsSince(t0);
+        std::cout << std::setw(8) << n << std::setprecision(2) << std::setw(14) << buildUs << std::setprecision(0)
+                  << std::setw(18) << samples / aliasSecs << std::setw(18) << samples / linearSecs
+                  << std::setprecision(1) << std::setw(9) << linearSecs / aliasSecs << "x\n";
+    }
+    std::cout << std::defaultfloat;
+    return sink ? 0 : 1;
+}
+
+// Chi-square goodness of fit of sample counts against expected weights.
+double chiSquareFit(const std::vector<long long>& observed, const std::vector<uint32_t>& weights, int& dof) {
+    long long n = 0;
+    uint64_t total = 0;
+    for (size_t i = 0; i < observed.size(); ++i) { n += observed[i]; total += weights[i]; }
+    double chi = 0;
+    dof = -1;
+    for (size_t i = 0; i < observed.size(); ++i) {
+        if (!weights[i]) continue;
+        dof++;
+        double e = (double)n * weights[i] / total;
+        chi += (observed[i] - e) * (observed[i] - e) / e;
+    }
+    return chi;
+}
+
+// rpg --alias-check [samples]: chi-square test of AliasTable against its
+// weights (random, skewed and zero-weight tables), plus the explore event
+// table and a level-ranged encounter table as the game builds them.
+// Sample counts below 100000 are raised to it so every entry of the
+// 300-weight table expects enough draws for the test to hold.
+int runAliasCheck(long long samples) {
+    samples = std::max(100000LL, samples);
+    rng.seed(4242);
+    bool ok = true;
+    auto check = [&](const char* what, const std::vector<uint32_t>& weights, auto&& draw) {
+        std::vector<long long> seen(weights.size());
+        for (long long i = 0; i < samples; ++i) seen[draw()]++;
+        int dof;
+        double chi = chiSquareFit(seen, weights, dof);
+        double crit = chiSquareCritical(dof);
+        bool zeroOk = true;
+        for (size_t i = 0; i < weights.size(); ++i) zeroOk &= weights[i] || !seen[i];
+        bool pass = (dof == 0 || chi < crit) && zeroOk;
+        ok &= pass;
+        std::cout << std::fixed << std::setprecision(2) << std::left << std::setw(26) << what << std::right << "chi-square " << chi
+                  << " (dof " << dof << ", critical " << crit << ")" << (zeroOk ? "" : " zero-weight entry sampled") << " "
+                  << (pass ? "PASS" : "FAIL") << "\n" << std::defaultfloat;
+    };
+    auto tableCheck = [&](const char* what, const std::vector<uint32_t>& weights) {
+        AliasTable t;
+        t.build(weights);
+        check(what, weights, [&] { return t.sample(rng); });
+    };
+
+    std::vector<uint32_t> random(300);
+    for (auto& w : random) w = (uint32_t)rng.range(1, 1000);
+    tableCheck("300 random weights", random);
+    tableCheck("skewed 1:10000:1:50", { 1, 10000, 1, 50 });
+    tableCheck("zero weights", { 0, 5, 0, 3, 2, 0 });
+    tableCheck("single entry", { 7 });
+    check("explore events", exploreEventWeights, [] { return exploreEvents(true).sample(rng); });
+
+    // A level-ranged location: at level 4 only the first two entries apply.
+    ContentPack::Builder b;
+    for (const auto& d : Catalog::items) b.items.push_back({ b.str(d.name), (int32_t)d.type, d.power, d.healAmount, d.price });
+    for (const auto& d : Catalog::enemies) b.addEnemy({ b.str(d.name), d.level, d.hp, d.attack, d.defense, d.xpReward, d.goldReward, 0, 0 }, {});
+    b.addLocation("check", { { 0, 3, 0, 0 }, { 1, 1, 2, 6 }, { 2, 5, 5, 0 }, { 3, 2, 0, 3 } });
+    ContentPack::Loaded pack;
+    pack.image = b.image();
+    ContentPack::Loaded saved = std::move(Content::active);
+    Content::active = std::move(pack);
+    Content::generation++;
+    const auto& level4 = Tables::encounters(0, 4);
+    check("encounters at level 4", { 3, 1, 0, 0 }, [&] { return (size_t)level4.sample(); });
+    bool rebuilt = Tables::encounters(0, 5).enemies.size() == 3;
+    ok &= rebuilt;
+    std::cout << std::left << std::setw(26) << "rebuild at level 5" << std::right << (rebuilt ? "PASS" : "FAIL") << "\n";
+    Content::active = std::move(saved);
+    Content::generation++;
+    return ok ? 0 : 1;
+}
+
+// rpg --rng-bench [draws]: raw, range(1, 100) and chance(15) draws/sec and
+// per-instance bytes for each generator, with a chi-square test of range().
+// "mt19937 + dist" is the pre-rng.h path: a uniform_int_distribution per call.
+// Draw counts below 100000 are raised to it so the chi-square test has data.
+int runRngBench(long long draws) {
+    draws = std::max(100000LL, draws);
+    bool ok = true;
+    uint64_t sink = 0;
+    std::cout << std::left << std::setw(18) << "generator" << std::right << std::setw(7) << "bytes" << std::setw(14) << "raw M/s"
+              << std::setw(14) << "range M/s" << std::setw(14) << "chance M/s" << std::setw(12) << "chi-square" << "\n" << std::fixed;
+    auto bench = [&](const char* name, size_t bytes, auto&& raw, auto&& range, auto&& chance) {
+        auto rate = [&](auto&& draw) {
+            auto t0 = std::chrono::steady_clock::now();
+            for (long long i = 0; i < draws; ++i) sink += (uint64_t)draw();
+            return draws / secondsSince(t0) / 1e6;
+        };
+        double rawRate = rate(raw), rangeRate = rate(range), chanceRate = rate(chance);
+        std::vector<long long> seen(100);
+        const long long samples = std::min(draws, 10000000LL);
+        for (long long i = 0; i < samples; ++i) seen[range() - 1]++;
+        int dof;
+        double chi = chiSquareFit(seen, std::vector<uint32_t>(100, 1), dof);
+        bool pass = chi < chiSquareCritical(dof);
+        ok &= pass;
+        std::cout << std::left << std::setw(18) << name << std::right << std::setw(7) << bytes << std::setprecision(1)
+                  << std::setw(14) << rawRate << std::setw(14) << rangeRate << std::setw(14) << chanceRate
+                  << std::setw(8) << chi << (pass ? " ok" : " FAIL") << "\n";
+    };
+    auto run = [&](const char* name, auto source) {
+        bench(name, sizeof source, [&] { return Rand::bits32(source.gen); }, [&] { return source.range(1, 100); }, [&] { return source.chance(15); });
+    };
+    run("mt19937 + dist", Rand::Source<std::mt19937>(1));
+    std::mt19937 mt(1);
+    bench("mt19937 + Lemire", sizeof mt, [&] { return Rand::bits32(mt); }, [&] { return Rand::range(mt, 1, 100); }, [&] { return Rand::chance(mt, 15); });
+    run("pcg32", Rand::Source<Rand::Pcg32>(1));
+    run("xoshiro256**", Rand::Source<Rand::Xoshiro256ss>(1));
+    run("splitmix64", Rand::Source<Rand::SplitMix64>(1));
+    std::cout << std::defaultfloat << "Game RNG: " << sizeof(RNG) << " bytes per thread"
+#ifdef RNG_LEGACY_MT19937
+              << " (legacy mt19937 build)"
+#endif
+              << "\n";
+    if (!sink) std::cout << "\n";
+    return ok ? 0 : 1;
+}
+
+// Where the main menu saves and loads; replays point it elsewhere.
+std::string saveFile = "save.dat";
+
+// The menu's load: save.dat, else the old text save.txt; a damaged save.dat
+// is reported rather than passed over for an older save.txt. A recorded session
+// logs the file it read, kind byte first ('B' binary, 'T' text, empty for
+// none), and its replay loads that instead of whatever is on disk now.
+bool loadSavedGame(Player& p) {
+    std::string bytes;
+    std::string_view data;
+    std::string path;
+    if (input.replaying()) {
+        input.replayFile(data);  // no record: nothing was found when recording
+        path = "session log";
+    } else {
+        if (MappedFile bin(saveFile); bin.ok()) {
+            bytes = 'B'; bytes.append(bin.data(), bin.size()); path = saveFile;
+        } else if (std::ifstream txt("save.txt", std::ios::binary); txt) {
+            bytes = 'T'; bytes.append(std::istreambuf_iterator<char>(txt), {}); path = "save.txt";
+        }
+        input.recordFile(bytes);
+        data = bytes;
+    }
+    if (data.empty()) {
+        screen << Color::red << "ບໍ່ພົບໄຟລ໌ບັນທຶກ." << Color::reset << "\n";
+        return false;
+    }
+    RPG_TRACE_SCOPE(LoadGame);
+    bool ok = false;
+    if (data[0] == 'B') ok = loadSaveImage(p, data.data() + 1, data.size() - 1);
+    else if (data[0] == 'T') {
+        std::istringstream ss(std::string(data.substr(1)));
+        ok = loadGameText(p, ss);
+    }
+    if (!ok) screen << Color::red << "ໄຟລ໌ບັນທຶກ " << path << " ເສຍຫາຍ, ບໍ່ໄດ້ໂຫຼດ." << Color::reset << "\n";
+    else if (!headless.quiet) screen << Color::green << "ໂຫຼດເກມຈາກ " << path << Color::reset << "\n";
+    return ok;
+}
+
+// Menu option 8: the best gear for a location, then the choice to put on
+// the best pair the player already owns.
+void gearAdvisor(Player& p, const World& world) {
+    screen << "ເລືອກສະຖານທີ່:\n";
+    for (size_t i = 0; i < world.size(); ++i) screen << "  [" << i+1 << "] " << world[i].name << "\n";
+    screen << "  [0] ຍົກເລີກ\n> ";
+    int l; if (!readInt(l)) return;
+    if (l <= 0 || l > (int)world.size()) return;
+    const Location loc = world[l-1];
+    const auto& a = Gear::advise(p, loc, std::max(1u, std::thread::hardware_concurrency()));
+    if (a.empty) { screen << "ບໍ່ມີສັດຕູທີ່ " << loc.name << " ສໍາລັບລະດັບຂອງເຈົ້າ.\n"; return; }
+
+    auto tenths = [](double v) { int t = (int)std::lround(v * 10); screen << t / 10 << '.' << t % 10; };
+    auto show = [&](const Gear::Pick& pk) {
+        screen << a.weapons[pk.weapon].item.name << " + " << a.armors[pk.armor].item.name << ": ~";
+        tenths(pk.hpLost);
+        screen << " HP/fight, ~";
+        tenths(pk.rounds);
+        screen << " rounds";
+        if (pk.cost) screen << Color::yellow << "  $" << pk.cost << Color::reset;
+        screen << "\n";
+    };
+    screen << Color::magenta << "\n== ອຸປະກອນທີ່ດີທີ່ສຸດສໍາລັບ " << loc.name << " ==" << Color::reset << "\n";
+    for (size_t i = 0; i < a.top.size(); ++i) { screen << "  " << (int)i + 1 << ") "; show(a.top[i]); }
+    const Gear::Pick& best = a.bestOwned;
+    const Item& w = a.weapons[best.weapon].item;
+    const Item& r = a.armors[best.armor].item;
+    screen << "\nດີທີ່ສຸດທີ່ມີ: "; show(best);
+    if (sameItem(w, p.weapon) && sameItem(r, p.armor)) { screen << "ເຈົ້າໃສ່ຊຸດນີ້ຢູ່ແລ້ວ.\n"; return; }
+    screen << "ໃສ່ຊຸດນີ້? 1) ແມ່ນ 0) ບໍ່\n> ";
+    int c; if (!readInt(c) || c != 1) return;
+    p.weapon = w;
+    p.armor = r;
+    screen << Color::green << "ໃສ່ແລ້ວ: " << w.name << " + " << r.name << Color::reset << "\n";
+}
+
+void mainMenu(Player& p) {
+    auto world = buildWorld();
+    bool warned = false;
+    while (true) {
+        if (autosave && autosave->failed() && !warned) { screen << Color::red << "ບັນທຶກອັດຕະໂນມັດບໍ່ສໍາເລັດ!" << Color::reset << "\n"; warned = true; }
+        screen << Color::bold << "\n===== Rift of Realms: ເກມ RPG ແບບຂໍ້ຄວາມ =====" << Color::reset << "\n";
+        showPlayer(p);
+        screen << "\nເລືອກການກະທໍາ:\n";
+        screen << "  1) ສໍາຫຼວດ\n  2) ຮ້ານຄ້າ\n  3) ຄັງຂອງ/ໃສ່ອຸປະກອນ\n  4) ບັນທຶກເກມ\n  5) ໂຫຼດເກມ\n  6) ພັກຜ່ອນທີ່ໂຮງແຮມ ($10)\n  7) ອອກ\n  8) ທີ່ປຶກສາອຸປະກອນ\n";
+        if (Trace::enabled) screen << "  9) ລາຍງານເວລາ (profile)\n";
+        screen << "> ";
+        int c;
+        if (!readInt(c)) { if (input.eof()) break; continue; }
+        if (c == 1) {
+            screen << "ເລືອກສະຖານທີ່:\n";
+            for (size_t i = 0; i < world.size(); ++i) screen << "  [" << i+1 << "] " << world[i].name << "\n";
+            screen << "  [0] ຍົກເລີກ\n> ";
+            int l; if (!readInt(l)) continue;
+            if (l <= 0 || l > (int)world.size()) continue;
+            explore(p, world[l-1]);
+        } else if (c == 2) {
+            shop(p);
+        } else if (c == 3) {
+            equipItem(p);
+        } else if (c == 4) {
+            saveGameBinary(p, saveFile);
+        } else if (c == 5) {
+            loadSavedGame(p);
+        } else if (c == 6) {
+            if (p.gold < 10) screen << Color::red << "ທອງບໍ່ພຽງພໍ!" << Color::reset << "\n";
+            else { p.gold -= 10; p.hp = p.maxHp; screen << Color::green << "ເຈົ້າຮູ້ສຶກຟື້ນຟູ!" << Color::reset << "\n"; }
+        } else if (c == 7) {
+            screen << "ລາກ່ອນ ນັກຜະຈົນໄພ!\n";
+            break;
+        } else if (c == 8) {
+            gearAdvisor(p, world);
+        } else if (c == 9 && Trace::enabled) {
+            screen << "\n" << Trace::summary();
+        }
+    }
+}
+
+// Final player state, to check that a replay ends where its recording did.
+uint64_t stateDigest(const Player& p) {
+    std::string s = p.name + "|" + p.weapon.name + "|" + p.armor.name;
+    for (int v : { p.level, p.xp, p.gold, p.hp, p.maxHp, p.attack, p.defense, p.weapon.power, p.armor.power }) s += "|" + std::to_string(v);
+    for (size_t i = 0; i < p.inv.size(); ++i) s += "|" + p.inv.item(i).name + "x" + std::to_string(p.inv.count(i));
+    return SessionLog::fnv1a(s);
+}
+
+uint64_t contentHash() { return SessionLog::fnv1a(Content::active.bytes()); }
+
+// One game: name prompt, then the main menu until the player quits or
+// input runs out. With a journal, a game cut short by a crash resumes from
+// its autosave instead, and a game that ends normally deletes it.
+Player playSession(Autosave::Journal* journal = nullptr) {
+    Player p = newHero();
+    screen << Color::bold << "\nຍິນດີຕ້ອນຮັບສູ່ Rift of Realms!" << Color::reset << "\n";
+    long long batches = 0;
+    if (journal && journal->recover(p, batches)) {
+        screen << Color::green << "ກູ້ຄືນເກມຈາກການບັນທຶກອັດຕະໂນມັດ (" << (int)batches << " batches)" << Color::reset << "\n";
+    } else {
+        screen << "ໃສ່ຊື່ຮີໂຣ (ກົດ Enter ເພື່ອ 'Hero'): ";
+        screen.present();
+        std::string_view nm;
+        if (input.line(nm) && !nm.empty()) p.name = std::string(nm);
+    }
+    if (journal) {
+        journal->start(p);
+        autosave = journal;
+        input.onIdle([](void* j) { static_cast<Autosave::Journal*>(j)->idle(); }, journal);
+    }
+    mainMenu(p);
+    if (journal) { input.onIdle(nullptr, nullptr); autosave = nullptr; journal->close(false); }
+    screen.present();
+    return p;
+}
+
+// Replays the session log at path with no terminal output. Saves go to a
+// scratch file next to the log, so a replay never touches save.dat.
+bool replaySession(const std::string& path, Player& out, double& secs, std::string& error) {
+    uint64_t seed, hash;
+    std::string_view extra;
+    input = Input(SessionLog::magic, sizeof hash);
+    if (!input.startReplay(path, seed, extra, error)) return false;
+    std::memcpy(&hash, extra.data(), sizeof hash);
+    if (hash != contentHash()) std::cerr << "warning: " << path << " was recorded with different content\n";
+    const std::string savedFile = saveFile;
+    saveFile = path + ".save";
+    const bool savedRender = screen.render, savedQuiet = headless.quiet;
+    screen.render = false;
+    headless.quiet = true;
+    rng.seed((unsigned)seed);
+    auto t0 = std::chrono::steady_clock::now();
+    out = playSession();
+    secs = secondsSince(t0);
+    screen.render = savedRender;
+    headless.quiet = savedQuiet;
+    std::remove(saveFile.c_str());
+    saveFile = savedFile;
+    return true;
+}
+
+// rpg --replay <log>: re-runs a recorded session and reports its speed and
+// whether the final state matches the recording. Exits non-zero on mismatch.
+int runReplay(const std::string& path) {
+    Player p;
+    double secs = 0;
+    std::string error;
+    if (!replaySession(path, p, secs, error)) { std::cerr << error << "\n"; return 1; }
+    uint64_t digest = stateDigest(p), recorded = 0;
+    std::cout << std::fixed << std::setprecision(1)
+              << "Replayed " << input.lines << " inputs (" << input.logBytes() << " bytes) in " << secs * 1000 << " ms: "
+              << input.lines / secs << " inputs/sec\n" << std::defaultfloat
+              << "Final: " << p.name << " LVL " << p.level << " XP " << p.xp << " Gold " << p.gold << " HP " << p.hp << "/" << p.maxHp
+              << "  digest " << std::hex << digest << std::dec << "\n";
+    if (!input.recordedDigest(recorded)) { std::cout << "No final state recorded (session did not end normally)\n"; return 0; }
+    std::cout << "Recorded digest " << std::hex << recorded << std::dec << (recorded == digest ? " MATCH" : " MISMATCH") << "\n";
+    return recorded == digest ? 0 : 1;
+}
+
+// rpg --replay-bench [inputs]: writes a synthetic session log of about
+// `inputs` lines (exploring, fighting, resting, shopping, using items),
+// replays it twice and reports replay speed, checking both replays end in
+// the same state.
+int runReplayBench(long long inputs) {
+    const std::string path = "replay_bench.log";
+    const char* cycle[] = { "1", "1", "1", "1", "2", "1", "1", "3", "1", "6", "2", "1", "0", "1", "3", "2", "1", "1", "6", "0" };
+    const uint64_t hash = contentHash();
+    std::string log = SessionLog::start(SessionLog::magic, 77, std::string_view((const char*)&hash, sizeof hash));
+    SessionLog::putInput(log, "Bench");
+    for (long long i = 0; i < inputs; ++i) SessionLog::putInput(log, cycle[i % std::size(cycle)]);
+    SessionLog::putInput(log, "7");
+    if (!writeFile(path, log)) { std::cerr << "cannot write " << path << "\n"; return 1; }
+
+    Player a, b;
+    double secsA = 0, secsB = 0;
+    std::string error;
+    bool ok = replaySession(path, a, secsA, error) && replaySession(path, b, secsB, error);
+    std::remove(path.c_str());
+    if (!ok) { std::cerr << error << "\n"; return 1; }
+    double secs = std::min(secsA, secsB);
+    bool same = stateDigest(a) == stateDigest(b);
+    std::cout << std::fixed << std::setprecision(1)
+              << "Log: " << input.lines << " inputs, " << log.size() << " bytes (" << (double)log.size() / input.lines << " bytes/input)\n"
+              << "Replay: " << secs * 1000 << " ms, " << input.lines / secs << " inputs/sec, " << log.size() / secs / 1e6 << " MB/s of log\n"
+              << std::defaultfloat << "Final: LVL " << a.level << " Gold " << a.gold << " HP " << a.hp << "/" << a.maxHp
+              << "  replays " << (same ? "identical PASS" : "differ FAIL") << "\n";
+    return same ? 0 : 1;
+}
+
+// rpg --journal-bench [actions] [items]: autosaves `actions` random changes
+// (gold, xp/level-ups, loot, drinking, equipping) to a hero carrying `items`
+// distinct items, reporting game-thread cost per capture against rewriting
+// save.dat per action. It then "crashes" (keeps the autosave files), checks
+// recovery reproduces the hero exactly, and again with a torn batch appended.
+int runJournalBench(long long actions, long long items) {
+    const std::string path = "journal_bench.dat";
+    Headless saved = headless;
+    headless.quiet = true;
+    rng.seed(31);
+    Player p = newHero();
+    p.name = "Journal Hero";
+    const Item kinds[] = { Factory::potionSmall(), Factory::potionLarge(), Factory::sword(), Factory::leather(), Factory::greatsword(), Factory::plate() };
+    for (long long i = 0; i < items; ++i) {
+        Item it = kinds[i % 6];
+        it.name += " #" + std::to_string(i);
+        p.inv.add(it);
+    }
+    const size_t stacks = p.inv.size();
+    auto t0 = std::chrono::steady_clock::now();
+    saveGameBinary(p, path);
+    double rewriteMs = secondsSince(t0) * 1000;
+    std::remove(path.c_str());
+
+    Autosave::Journal journal(path);
+    journal.start(p);
+    std::vector<uint32_t> captureNs;
+    captureNs.reserve((size_t)actions);
+    t0 = std::chrono::steady_clock::now();
+    for (long long i = 0; i < actions; ++i) {
+        switch (rng.range(0, 4)) {
+        case 0: p.gold += rng.range(-20, 40); break;
+        case 1: Progression::grant(p, rng.range(5, 60)); break;
+        case 2: p.inv.add(kinds[rng.range(0, 5)]); break;
+        case 3: if (!p.inv.empty()) p.inv.removeAt(rng.range(0, (int)p.inv.size() - 1)); break;
+        case 4: if (!p.inv.empty()) { useItem(p, rng.range(0, (int)p.inv.size() - 1)); p.hp = std::max(1, p.hp - rng.range(0, 9)); } break;
+        }
+        auto c0 = std::chrono::steady_clock::now();
+        Autosave::capture(journal);
+        captureNs.push_back((uint32_t)std::min<long long>(0xFFFFFFFFLL, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - c0).count()));
+        if (i % 16 == 15) journal.idle();  // the player pauses; compaction happens here
+    }
+    double playSecs = secondsSince(t0);
+    t0 = std::chrono::steady_clock::now();
+    journal.flush();
+    double drainMs = secondsSince(t0) * 1000;
+    const Autosave::Writer& w = *journal.stats();
+    long long batches = w.batches, bytes = w.bytes, snapshots = w.snapshots;
+    journal.close(true);  // leaves the files behind, as a crash would
+    headless = saved;
+
+    std::sort(captureNs.begin(), captureNs.end());
+    auto pct = [&](double q) { return captureNs.empty() ? 0.0 : captureNs[std::min(captureNs.size() - 1, (size_t)(q * captureNs.size()))] / 1000.0; };
+    std::cout << std::fixed << std::setprecision(1)
+              << "Hero: " << stacks << " stacks, full save.dat rewrite " << std::setprecision(3) << rewriteMs << " ms per action\n"
+              << std::setprecision(1) << "Autosave: " << actions << " actions, " << actions / playSecs << " actions/sec on the game thread\n"
+              << "  capture p50 " << pct(0.50) << " us  p99 " << pct(0.99) << " us  max " << pct(1.0) << " us\n"
+              << "  " << bytes << " bytes in " << batches << " batches, " << snapshots << " snapshots; writer drained in " << drainMs << " ms\n";
+
+    auto check = [&](const char* what, const Player& expect) {
+        Player r;
+        long long applied = 0;
+        bool ok = Autosave::Journal(path).recover(r, applied) && stateDigest(r) == stateDigest(expect);
+        std::cout << "Recovery " << what << ": " << applied << " batches applied, " << (ok ? "state identical PASS" : "FAIL") << "\n";
+        return ok;
+    };
+    bool ok = check("after crash", p);
+    {
+        std::ofstream torn(path + ".journal", std::ios::binary | std::ios::app);
+        const uint32_t frame[2] = { 64, 0 };
+        torn.write((const char*)frame, sizeof frame);
+        torn << "GX";  // a batch cut short
+    }
+    ok &= check("with torn tail", p);
+
+    // The next session recovers and snapshots, then crashes after renaming
+    // the snapshot but before replacing the journal: the old journal is
+    // still there and must not be applied a second time.
+    {
+        std::ifstream in(path + ".journal", std::ios::binary);
+        const std::string oldJournal((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        Player resumed;
+        long long applied = 0;
+        Autosave::Journal next(path);
+        next.recover(resumed, applied);
+        next.start(resumed);
+        next.close(true);
+        writeFile(path + ".journal", oldJournal);
+        ok &= check("after a crash mid-compaction", resumed);
+    }
+    Autosave::Journal(path).close(false);
+    std::remove((path + ".autosave").c_str());
+    std::remove((path + ".journal").c_str());
+    std::cout << std::defaultfloat;
+    return ok ? 0 : 1;
+}
+
+// rpg --gear-bench [weapons] [armors]: scores every weapon x armor pair of a
+// large inventory on one thread and on all cores, times cached repeats, and
+// checks the analytic model against simulated fights. Exits non-zero if the
+// thread counts disagree or a prediction is off by more than 0.5%.
+int runGearBench(long long weapons, long long armors) {
+    Headless saved = headless;
+    headless.quiet = true;
+    rng.seed(18);
+    const auto world = buildWorld();
+    const Location loc = world[world.size() - 1];
+    Player p = newHero();
+    p.level = 4; p.attack = 11; p.defense = 5;
+    for (long long i = 0; i < weapons; ++i) p.inv.add(Item{ "Blade #" + std::to_string(i), ItemType::Weapon, (int)(i % 23), 0, (int)(10 + i % 97) });
+    for (long long i = 0; i < armors; ++i) p.inv.add(Item{ "Mail #" + std::to_string(i), ItemType::Armor, (int)(i % 19), 0, (int)(10 + i % 89) });
+
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << Color::bold << "\n== Gear advisor: " << loc.name << ", level " << p.level << " ==" << Color::reset << "\n";
+    std::vector<Gear::Pick> reference;
+    bool ok = true;
+    size_t pairs = 0;
+    for (unsigned threads : { 1u, cores }) {
+        Gear::cache.entries.clear();
+        auto t0 = std::chrono::steady_clock::now();
+        const auto& a = Gear::advise(p, loc, threads);
+        double secs = secondsSince(t0);
+        pairs = a.weapons.size() * a.armors.size();
+        std::cout << std::fixed << std::setprecision(1) << std::setw(3) << threads << " threads: " << pairs << " pairs in "
+                  << secs * 1000 << " ms, " << std::setprecision(0) << pairs / std::max(secs, 1e-9) << " pairs/sec\n";
+        if (reference.empty()) { reference = a.top; continue; }
+        bool same = reference.size() == a.top.size();
+        for (size_t i = 0; same && i < reference.size(); ++i)
+            same = reference[i].weapon == a.top[i].weapon && reference[i].armor == a.top[i].armor && reference[i].hpLost == a.top[i].hpLost;
+        if (!same) { std::cout << Color::red << "Thread counts disagree on the best pairs" << Color::reset << "\n"; ok = false; }
+    }
+
+    const int repeats = 1000;
+    long long hitsBefore = Gear::cache.hits;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; ++i) Gear::advise(p, loc, cores);
+    std::cout << "Cached query: " << std::setprecision(1) << secondsSince(t0) * 1e6 / repeats << " us (" << Gear::cache.hits - hitsBefore
+              << "/" << repeats << " hits, " << p.inv.size() << " stacks)\n";
+    if (Gear::cache.hits - hitsBefore != repeats) ok = false;
+
+    // Model vs. combat(): attack-only fights with HP to spare, enemies
+    // drawn and scaled the way explore() does.
+    const auto& enc = Tables::encounters(loc.index, p.level);
+    headless.policy = [](const Player&, const Enemy&) { return 1; };
+    const auto& a = Gear::advise(p, loc, cores);
+    const int fights = 200000;  // enough that sampling noise stays well inside 0.5%
+    std::cout << "Predicted vs simulated HP lost per fight (" << fights << " fights):\n";
+    const Player bare = newHero();
+    const std::pair<Item, Item> checks[] = {
+        { a.weapons[a.top.front().weapon].item, a.armors[a.top.front().armor].item },
+        { Factory::sword(), Factory::leather() },
+        { bare.weapon, bare.armor },
+    };
+    for (const auto& [weapon, armor] : checks) {
+        Player h = newHero();
+        h.level = p.level; h.attack = p.attack; h.defense = p.defense;
+        h.weapon = weapon;
+        h.armor = armor;
+        Gear::Advice one;
+        one.weapons = { { weapon, true } };
+        one.armors = { { armor, true } };
+        Gear::evaluate(h, enc, one, 1);
+        const double predicted = one.top.front().hpLost;
+        long long lost = 0;
+        for (int f = 0; f < fights; ++f) {
+            Enemy e = spawnEnemy(enc.sample());
+            e.attack += rng.range(0, 2);
+            e.defense += rng.range(0, 2);
+            e.maxHp += rng.range(0, 6); e.hp = e.maxHp;
+            h.hp = h.maxHp = 1000000;
+            h.level = p.level; h.attack = p.attack; h.defense = p.defense; h.xp = 0;
+            combat(h, e);
+            lost += 1000000 - h.hp;
+        }
+        double simulated = (double)lost / fights;
+        double err = std::fabs(predicted - simulated) / std::max(simulated, 1.0);
+        std::cout << "  " << std::left << std::setw(28) << (h.weapon.name + " + " + h.armor.name) << std::right << std::setprecision(2)
+                  << std::setw(8) << predicted << std::setw(8) << simulated << "  (" << std::setprecision(1) << err * 100 << "%)\n";
+        if (err > 0.005) ok = false;
+    }
+    std::cout << std::defaultfloat;
+    headless = saved;
+    std::cout << (ok ? "PASS" : "FAIL") << "\n";
+    return ok ? 0 : 1;
+}
+
+// rpg --odds-check [fights]: Odds::evaluate() against `fights` simulated
+// combat() runs per matchup (several policies, potion stacks, an escape
+// policy and a long fight), and the time each takes. Exits non-zero if an
+// exact figure falls outside 4 standard errors of the simulated one.
+// Fight counts below 10000 are raised to it: with fewer, the rare-outcome
+// slack in within() grows loose enough to pass almost anything.
+int runOddsCheck(long long fights) {
+    Headless saved = headless;
+    headless.quiet = true;
+    rng.seed(22);
+    fights = std::max(10000LL, fights);
+
+    struct Case { const char* name; Player hero; Enemy foe; Odds::Policy policy; };
+    std::vector<Case> cases;
+    for (const Enemy& proto : simPrototypes()) cases.push_back({ proto.name(), newHero(), proto, scriptedPolicy });
+    {
+        Case c{ "bandit, attack only", newHero(), Factory::bandit(), [](const Player&, const Enemy&) { return 1; } };
+        c.hero.inv.clear();
+        cases.push_back(c);
+    }
+    cases.push_back({ "wolf, flee when hurt", newHero(), Factory::wolf(),
+                      [](const Player& p, const Enemy&) { return p.hp * 2 < p.maxHp ? 4 : 1; } });
+    {
+        Case c{ "dragonling, mixed potions", newHero(), Factory::dragonling(), scriptedPolicy };
+        c.hero.inv.add(ItemId::PotionLarge, 2);
+        c.hero.inv.add(ItemId::Sword);
+        c.hero.inv.add(ItemId::PotionSmall, 3);
+        cases.push_back(c);
+    }
+    {
+        Case c{ "long fight", newHero(), Factory::dragonling(), scriptedPolicy };
+        c.hero.maxHp = c.hero.hp = 400;
+        c.foe.maxHp = c.foe.hp = 300;
+        c.foe.attack = 9;
+        cases.push_back(c);
+    }
+
+    bool ok = true;
+    double exactSecs = 0, simSecs = 0;
+    std::cout << Color::bold << "\n== Exact odds vs. " << fights << " simulated fights ==" << Color::reset << "\n";
+    std::cout << "  matchup                      win% exact/sim      turns exact/sim    HP left exact/sim      exact  speedup\n";
+    for (Case& c : cases) {
+        Odds::memo = Odds::Memo{};
+        auto t0 = std::chrono::steady_clock::now();
+        const Odds::Result r = Odds::evaluate(c.hero, c.foe, c.policy);
+        const double exact = secondsSince(t0);
+        exactSecs += exact;
+
+        // Summed outcomes and squares, for standard errors. No XP, so no
+        // level-up refills the hero's HP before it is read.
+        headless.policy = c.policy;
+        c.foe.xpReward = 0;
+        double wins = 0, fled = 0, turns = 0, turns2 = 0, hp = 0, hp2 = 0;
+        t0 = std::chrono::steady_clock::now();
+        for (long long f = 0; f < fights; ++f) {
+            Player h = c.hero;
+            const bool won = combat(h, c.foe);
+            wins += won;
+            fled += !won && h.hp > 0;
+            turns += headless.lastTurns; turns2 += (double)headless.lastTurns * headless.lastTurns;
+            hp += h.hp; hp2 += (double)h.hp * h.hp;
+        }
+        const double sim = secondsSince(t0);
+        simSecs += sim;
+
+        const double n = (double)fights;
+        // Slack of 3 * scale / n covers outcomes too rare to show up in n
+        // fights, where the sampled deviation is 0.
+        auto within = [n](double exact, double sum, double sumSq, double scale) {
+            const double mean = sum / n, sd = std::sqrt(std::max(0.0, sumSq / n - mean * mean));
+            return std::fabs(exact - mean) <= 4 * sd / std::sqrt(n) + 3 * scale / n;
+        };
+        const double hpScale = std::max(c.hero.hp, c.hero.maxHp);
+        const bool good = within(r.win, wins, wins, 1) && within(r.fled, fled, fled, 1) && within(r.turns, turns, turns2, c.foe.hp + hpScale)
+                          && within(r.hpLeft, hp, hp2, hpScale) && std::fabs(r.win + r.loss + r.fled - 1) < 1e-9;
+        ok = ok && good;
+        std::cout << "  " << std::left << std::setw(27) << c.name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(8) << r.win * 100 << std::setw(8) << wins / n * 100
+                  << std::setw(10) << r.turns << std::setw(8) << turns / n
+                  << std::setw(10) << r.hpLeft << std::setw(8) << hp / n
+                  << std::setprecision(0) << std::setw(9) << exact * 1e6 << " us" << std::setw(7) << sim / std::max(exact, 1e-9) << "x"
+                  << (good ? "" : "  MISMATCH") << "\n";
+    }
+
+    // Warm memo, the way a caller scoring many matchups would see it.
+    const int repeats = 200;
+    auto t0 = std::chrono::steady_clock::now();
+    double sink = 0;
+    for (int i = 0; i < repeats; ++i) sink += Odds::evaluate(cases[0].hero, cases[0].foe, scriptedPolicy).win;
+    const double warm = secondsSince(t0) / repeats;
+    std::cout << std::setprecision(1) << "Exact: " << exactSecs * 1e3 << " ms for " << cases.size() << " matchups (" << warm * 1e6
+              << " us per warm " << cases[0].name << "), simulated: " << simSecs * 1e3 << " ms, " << std::setprecision(0)
+              << simSecs / std::max(exactSecs, 1e-9) << "x\n" << std::defaultfloat;
+    headless = saved;
+    std::cout << (ok && sink >= 0 ? "PASS" : "FAIL") << "\n";
+    return ok ? 0 : 1;
+}
+
+// rpg --level-bench [grants]: Progression::grant() against the old
+// one-level-per-iteration loop, on the default curve and a quadratic one.
+// Times grants of 10^9 XP and 10^9 XP handed out 1000 at a time. Exits
+// non-zero if the two ever disagree.
+int runLevelBench(long long grants) {
+    Headless saved = headless;
+    headless.quiet = true;
+    const Progression::Curve defaults = Progression::curve;
+    auto loop = [](Player& p, long long xp) {
+        const auto& c = Progression::curve;
+        p.xp += (int)xp;
+        while (p.level < c.maxLevel && p.xp >= c.need(p.level)) {
+            p.xp -= (int)c.need(p.level);
+            p.level++;
+            p.maxHp += c.hpPerLevel;
+            p.attack += c.attackPerLevel;
+            p.defense += c.defensePerLevel;
+            p.hp = p.maxHp;
+        }
+    };
+    static thread_local long long events;
+    Progression::onLevelUp = [](const Player&, int, int) { events++; };
+
+    bool ok = true;
+    Progression::Curve quadratic;
+    quadratic.base = 50; quadratic.linear = 10; quadratic.quadratic = 3; quadratic.maxLevel = 5000;
+    quadratic.hpPerLevel = 7; quadratic.attackPerLevel = 1; quadratic.defensePerLevel = 2;
+    for (const auto& [name, curve] : { std::pair<const char*, Progression::Curve>{ "level*20", defaults }, { "50+10L+3L^2, cap 5000", quadratic } }) {
+        Progression::configure(curve);
+        rng.seed(19);
+        long long mismatches = 0;
+        for (int i = 0; i < 200000; ++i) {
+            Player a = newHero();
+            a.level = rng.range(1, 300);
+            a.xp = rng.range(0, (int)std::min<long long>(INT_MAX, curve.need(a.level) - 1));
+            Player b = a;
+            const long long xp = rng.range(0, 1 << rng.range(0, 24));
+            loop(a, xp);
+            Progression::grant(b, xp);
+            mismatches += a.level != b.level || a.xp != b.xp || a.maxHp != b.maxHp || a.attack != b.attack || a.defense != b.defense || a.hp != b.hp;
+        }
+        std::cout << "Curve " << name << ": 200000 random grants, " << mismatches << " mismatches " << (mismatches ? "FAIL" : "PASS") << "\n";
+        ok = ok && mismatches == 0;
+    }
+    Progression::configure(defaults);
+
+    std::cout << Color::bold << "\n== 10^9 XP ==" << Color::reset << "\n" << std::fixed << std::setprecision(1);
+    const long long billion = 1000000000;
+    for (int mode = 0; mode < 2; ++mode) {
+        const long long per = mode == 0 ? billion : 1000, count = mode == 0 ? grants : billion / per;
+        double ns[2];
+        Player end[2];
+        for (int impl = 0; impl < 2; ++impl) {
+            events = 0;
+            Player p = newHero();
+            auto t0 = std::chrono::steady_clock::now();
+            for (long long i = 0; i < count; ++i) {
+                if (mode == 0) { p.level = 1; p.xp = 0; p.maxHp = 35; p.attack = 6; p.defense = 2; }
+                if (impl == 0) loop(p, per); else Progression::grant(p, per);
+            }
+            ns[impl] = secondsSince(t0) * 1e9 / count;
+            end[impl] = p;
+        }
+        ok = ok && end[0].level == end[1].level && end[0].xp == end[1].xp;
+        std::cout << (mode == 0 ? "One grant of 10^9 XP" : "10^6 grants of 1000 XP") << " (to level " << end[1].level << "): loop "
+                  << ns[0] << " ns, table " << ns[1] << " ns per grant, " << ns[0] / std::max(ns[1], 1e-3) << "x; "
+                  << events << " level-up events\n";
+    }
+    std::cout << std::defaultfloat;
+    Progression::onLevelUp = Progression::announce;
+    headless = saved;
+    std::cout << (ok ? "PASS" : "FAIL") << "\n";
+    return ok ? 0 : 1;
+}
+
+// rpg --input-bench [moves]: writes a file of menu moves (with blank lines,
+// padding, '+' signs, CRLF and junk mixed in) and parses it four ways: the
+// old std::cin >> int with clear()/ignore(), getline + parseInt(), and
+// LineReader reading the file and a pipe fed by another thread. Exits
+// non-zero if the parsers disagree.
+int runInputBench(long long moves) {
+    const std::string path = "input_bench.txt";
+    rng.seed(20);
+    std::string text;
+    for (long long i = 0; i < moves; ++i) {
+        const int v = rng.range(0, 9), form = rng.range(0, 19);
+        if (form == 0) text += "\n";  // a blank line before the move
+        if (form == 1) text += "x\n";
+        else if (form == 2) text += "  " + std::to_string(v) + "\n";
+        else if (form == 3) text += "+" + std::to_string(v) + "\r\n";
+        else text += std::to_string(v) + "\n";
+    }
+    if (!writeFile(path, text)) { std::cerr << "cannot write " << path << "\n"; return 1; }
+
+    struct Tally { long long numbers = 0, invalid = 0, sum = 0; };
+    auto count = [](Tally& t, std::string_view line) {
+        int v;
+        Parsed r = parseInt(line, v);
+        if (r == Parsed::Number) { t.numbers++; t.sum += v; }
+        else if (r == Parsed::Invalid) t.invalid++;
+    };
+    std::vector<std::pair<const char*, Tally>> runs;
+    std::cout << Color::bold << "\n== " << moves << " moves, " << text.size() / 1024 << " KB ==" << Color::reset << "\n" << std::fixed << std::setprecision(0);
+    auto report = [&](const char* name, const Tally& t, double secs) {
+        runs.push_back({ name, t });
+        std::cout << std::left << std::setw(26) << name << std::right << std::setw(12) << t.numbers / std::max(secs, 1e-9) << " commands/sec\n";
+    };
+
+    {
+        std::ifstream f(path, std::ios::binary);
+        Tally t;
+        auto t0 = std::chrono::steady_clock::now();
+        int v;
+        while (f.peek() != EOF) {
+            if (f >> v) { t.numbers++; t.sum += v; }
+            else if (!f.eof()) { f.clear(); t.invalid++; }
+            f.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        }
+        report("istream >> int", t, secondsSince(t0));
+    }
+    {
+        std::ifstream f(path, std::ios::binary);
+        Tally t;
+        std::string line;
+        auto t0 = std::chrono::steady_clock::now();
+        while (std::getline(f, line)) count(t, line);
+        report("getline + from_chars", t, secondsSince(t0));
+    }
+    {
+#ifdef _WIN32
+        int fd = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+#endif
+        LineReader reader(fd);
+        Tally t;
+        std::string_view line;
+        auto t0 = std::chrono::steady_clock::now();
+        while (reader.line(line)) count(t, line);
+        report("LineReader, file", t, secondsSince(t0));
+#ifdef _WIN32
+        _close(fd);
+#else
+        ::close(fd);
+#endif
+    }
+    long long pending = 0, reads = 0;
+    {
+        int fds[2];
+#ifdef _WIN32
+        if (_pipe(fds, 64 * 1024, _O_BINARY) != 0) return 1;
+#else
+        if (::pipe(fds) != 0) return 1;
+#endif
+        auto t0 = std::chrono::steady_clock::now();
+        std::thread feeder([&] {
+            for (size_t at = 0; at < text.size(); ) {
+#ifdef _WIN32
+                int n = _write(fds[1], text.data() + at, (unsigned)std::min<size_t>(text.size() - at, 4096));
+#else
+                ssize_t n = ::write(fds[1], text.data() + at, std::min<size_t>(text.size() - at, 4096));
+#endif
+                if (n <= 0) break;
+                at += (size_t)n;
+            }
+#ifdef _WIN32
+            _close(fds[1]);
+#else
+            ::close(fds[1]);
+#endif
+        });
+        // Poll mode: count how often the reader had nothing ready, where
+        // the game would render or autosave instead of blocking.
+        LineReader reader(fds[0]);
+        Tally t;
+        std::string_view line;
+        for (LineReader::Status s; (s = reader.poll(line)) != LineReader::Status::End; ) {
+            if (s == LineReader::Status::Line) count(t, line);
+            else { pending++; std::this_thread::yield(); }
+        }
+        feeder.join();
+        report("LineReader, pipe, poll()", t, secondsSince(t0));
+        reads = reader.reads;
+#ifdef _WIN32
+        _close(fds[0]);
+#else
+        ::close(fds[0]);
+#endif
+    }
+    std::remove(path.c_str());
+
+    bool ok = true;
+    for (const auto& [name, t] : runs) ok = ok && t.numbers == runs[0].second.numbers && t.invalid == runs[0].second.invalid && t.sum == runs[0].second.sum;
+    std::cout << std::defaultfloat << "Pipe: " << reads << " reads, " << pending << " polls found no line ready\n";
+    std::cout << runs[0].second.numbers << " numbers, " << runs[0].second.invalid << " invalid lines, sum " << runs[0].second.sum
+              << ", parsers " << (ok ? "agree PASS" : "disagree FAIL") << "\n";
+    return ok ? 0 : 1;
+}
+
+
+#ifdef __linux__
+// Shared world: many players in one world on one host. A simulation thread
+// owns every Player and plays the game's own rules (explore(), buyItem(),
+// useItem()) on them in batched ticks; I/O threads own the sockets. Commands
+// reach the simulation through one bounded MPSC queue and rendered replies
+// go back through a bounded SPSC queue per I/O thread, so game logic takes
+// no locks and never touches a descriptor. One line each way over a Unix
+// domain socket; the server greets with "ready <locations>", then answers
+//   explore <n>  with won|lost|gold|potion|rest <level> <hp> <maxHp> <gold>
+//   rest         with rested|poor and the same stats (the inn, $10)
+//   buy <n>      with bought|poor ... (shop item n)
+//   use <n>      with used ... (inventory item n)
+//   who          with "who <online> <players at your location>"
+// and anything else with "invalid". Fights use scriptedPolicy().
+namespace Realm {
+    inline size_t roundUpPow2(size_t n) {
+        size_t c = 1;
+        while (c < n) c <<= 1;
+        return c;
+    }
+
+    // Bounded single-producer, single-consumer ring. Each side caches the
+    // other's index and rereads it only when the ring looks full or empty.
+    template <class T>
+    class SpscQueue {
+    public:
+        explicit SpscQueue(size_t capacity) : slots(roundUpPow2(capacity)), mask(slots.size() - 1) {}
+
+        bool push(const T& v) {
+            const size_t t = tail.load(std::memory_order_relaxed);
+            if (t - headSeen == slots.size()) {
+                headSeen = head.load(std::memory_order_acquire);
+                if (t - headSeen == slots.size()) return false;
+            }
+            slots[t & mask] = v;
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool pop(T& out) {
+            const size_t h = head.load(std::memory_order_relaxed);
+            if (h == tailSeen) {
+                tailSeen = tail.load(std::memory_order_acquire);
+                if (h == tailSeen) return false;
+            }
+            out = slots[h & mask];
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        std::vector<T> slots;
+        size_t mask;
+        alignas(64) std::atomic<size_t> head{0};  // consumer's line
+        size_t tailSeen = 0;
+        alignas(64) std::atomic<size_t> tail{0};  // producer's line
+        size_t headSeen = 0;
+    };
+
+    // Bounded multi-producer, single-consumer queue (Vyukov's bounded
+    // queue): a producer claims a cell with one CAS on the tail, and each
+    // cell's sequence number says whether it is free or full.
+    template <class T>
+    class MpscQueue {
+    public:
+        explicit MpscQueue(size_t capacity) : cells(roundUpPow2(capacity)), mask(cells.size() - 1) {
+            for (size_t i = 0; i < cells.size(); ++i) cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+
+        bool push(const T& v) {
+            size_t pos = tail.load(std::memory_order_relaxed);
+            Cell* c;
+            while (true) {
+                c = &cells[pos & mask];
+                const intptr_t dif = (intptr_t)c->seq.load(std::memory_order_acquire) - (intptr_t)pos;
+                if (dif == 0) { if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break; }
+                else if (dif < 0) return false;
+                else pos = tail.load(std::memory_order_relaxed);
+            }
+            c->value = v;
+            c->seq.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer only.
+        bool pop(T& out) {
+            Cell& c = cells[head & mask];
+            if (c.seq.load(std::memory_order_acquire) != head + 1) return false;
+            out = c.value;
+            c.seq.store(head + mask + 1, std::memory_order_release);
+            head++;
+            return true;
+        }
+
+        bool empty() const { return cells[head & mask].seq.load(std::memory_order_acquire) != head + 1; }
+
+    private:
+        struct Cell { std::atomic<size_t> seq; T value; };
+        std::vector<Cell> cells;
+        size_t mask;
+        size_t head = 0;
+        alignas(64) std::atomic<size_t> tail{0};
+    };
+
+    enum class Op : uint8_t { Join, Leave, Explore, Rest, Buy, Use, Who, Invalid };
+
+    // A session is (I/O thread, slot, generation); the generation tells a
+    // reused slot's new connection from the one a late reply was meant for.
+    struct Command { uint32_t slot, gen; int32_t arg; uint8_t io; Op op; };
+    struct Reply { uint32_t slot, gen; uint8_t len; char text[55]; };
+    static_assert(sizeof(Command) == 16 && sizeof(Reply) == 64, "messages should stay compact");
+
+    Command parse(std::string_view line) {
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        Command c{};
+        const size_t sp = line.find(' ');
+        const std::string_view verb = line.substr(0, sp);
+        const bool hasArg = sp != std::string_view::npos;
+        if (hasArg && std::from_chars(line.data() + sp + 1, line.data() + line.size(), c.arg).ec != std::errc()) c.op = Op::Invalid;
+        else if (verb == "explore" && hasArg) c.op = Op::Explore;
+        else if (verb == "buy" && hasArg) c.op = Op::Buy;
+        else if (verb == "use" && hasArg) c.op = Op::Use;
+        else if (verb == "rest" && !hasArg) c.op = Op::Rest;
+        else if (verb == "who" && !hasArg) c.op = Op::Who;
+        else c.op = Op::Invalid;
+        return c;
+    }
+
+    // Renders into a Reply in place, so replies never allocate.
+    struct Line {
+        Reply& r;
+        Line& operator<<(std::string_view s) {
+            const size_t n = std::min(s.size(), sizeof r.text - 1 - r.len);  // room for the '\n'
+            std::memcpy(r.text + r.len, s.data(), n);
+            r.len += (uint8_t)n;
+            return *this;
+        }
+        Line& operator<<(long long v) {
+            char tmp[24];
+            return *this << std::string_view(tmp, (size_t)(std::to_chars(tmp, tmp + sizeof tmp, v).ptr - tmp));
+        }
+        void end() { r.text[r.len++] = '\n'; }
+    };
+
+    constexpr unsigned maxIoThreads = 255;  // Command::io is a uint8_t
+
+    struct Config { unsigned ioThreads = 2; size_t queueCapacity = 1 << 16; size_t maxBatch = 4096; uint64_t seed = 1; };
+
+    class Server {
+    public:
+        // Written by the simulation thread; read by anyone.
+        std::atomic<long long> ticks{0}, commands{0}, online{0};
+        size_t peak = 0;
+
+        explicit Server(const Config& cfg) : cfg(cfg), inbox(cfg.queueCapacity) {
+            for (unsigned i = 0; i < std::clamp(cfg.ioThreads, 1u, maxIoThreads); ++i) io.push_back(std::make_unique<Io>(cfg.queueCapacity));
+            heroes.resize(io.size());
+        }
+
+        ~Server() {
+            for (auto& t : io) {
+                for (Session& s : t->sessions) if (s.fd >= 0) ::close(s.fd);
+                for (int fd : { t->epollFd, t->wakeFd }) if (fd >= 0) ::close(fd);
+            }
+            for (int fd : { listenFd, simWake }) if (fd >= 0) ::close(fd);
+            if (!path.empty()) unlink(path.c_str());
+        }
+
+        bool listen(const std::string& socketPath, std::string& error) {
+            sockaddr_un addr{};
+            if (socketPath.size() >= sizeof addr.sun_path) { error = "socket path too long"; return false; }
+            addr.sun_family = AF_UNIX;
+            std::memcpy(addr.sun_path, socketPath.c_str(), socketPath.size() + 1);
+            unlink(socketPath.c_str());
+            listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (listenFd < 0 || bind(listenFd, (sockaddr*)&addr, sizeof addr) < 0 || ::listen(listenFd, SOMAXCONN) < 0) {
+                error = "cannot listen on " + socketPath + ": " + std::strerror(errno);
+                return false;
+            }
+            path = socketPath;
+            simWake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (simWake < 0) { error = std::string("eventfd: ") + std::strerror(errno); return false; }
+            // Every I/O thread watches the listener; EPOLLEXCLUSIVE wakes
+            // one of them per connection, and that one accepts it.
+            for (auto& t : io) {
+                t->epollFd = epoll_create1(EPOLL_CLOEXEC);
+                t->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+                if (t->epollFd < 0 || t->wakeFd < 0) { error = std::string("epoll: ") + std::strerror(errno); return false; }
+                watch(*t, listenFd, listenTag, EPOLLIN | EPOLLEXCLUSIVE);
+                watch(*t, t->wakeFd, wakeTag, EPOLLIN);
+            }
+            return true;
+        }
+
+        // Runs the simulation on the calling thread and the I/O threads
+        // beside it, until stop() is called from another thread.
+        void run() {
+            for (unsigned i = 0; i < io.size(); ++i) io[i]->thread = std::thread([this, i] { ioLoop(i); });
+            simLoop();
+            for (auto& t : io) t->thread.join();
+        }
+
+        void stop() {
+            stopping.store(true);
+            wake(simWake);
+            for (auto& t : io) wake(t->wakeFd);
+        }
+
+    private:
+        static constexpr uint64_t listenTag = ~0ULL, wakeTag = ~0ULL - 1;
+
+        // One connection, owned by its I/O thread.
+        struct Session {
+            int32_t fd = -1;  // -1: slot is free
+            uint32_t gen = 0;
+            uint8_t inLen = 0;
+            bool discarding = false;  // inside an overlong line: drop input up to '\n'
+            char in[22];      // unfinished input line
+        };
+
+        struct Io {
+            int epollFd = -1, wakeFd = -1;
+            std::vector<Session> sessions;
+            std::vector<uint32_t> freeSlots;
+            std::vector<uint32_t> dropped;  // sessions whose replies could not be written
+            SpscQueue<Reply> outbox;
+            bool pushed = false;            // commands queued since the simulation was last woken
+            bool acceptPaused = false;      // listener unwatched for lack of descriptors (acceptLock)
+            std::thread thread;
+
+            explicit Io(size_t capacity) : outbox(capacity) {}
+        };
+
+        // One player, owned by the simulation thread.
+        struct Hero {
+            Player p;
+            int32_t location = -1;
+        };
+
+        Config cfg;
+        std::string path;
+        int listenFd = -1, simWake = -1;
+        std::atomic<bool> stopping{false}, simAsleep{false}, acceptPaused{false};
+        std::mutex acceptLock;
+        MpscQueue<Command> inbox;
+        std::vector<std::unique_ptr<Io>> io;
+        std::vector<std::vector<Hero>> heroes;  // [I/O thread][slot]
+        std::vector<uint32_t> population;       // players per location
+
+        static void wake(int fd) { uint64_t one = 1; (void)!write(fd, &one, sizeof one); }
+
+        void watch(Io& t, int fd, uint64_t tag, uint32_t events) {
+            epoll_event ev{};
+            ev.events = events;
+            ev.data.u64 = tag;
+            epoll_ctl(t.epollFd, EPOLL_CTL_ADD, fd, &ev);
+        }
+
+        // Sleep/wake handshake: the simulation raises simAsleep and then
+        // checks the queue; a producer pushes and then checks simAsleep.
+        // The fences make at least one of them see the other.
+        void notifySim() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (simAsleep.load(std::memory_order_relaxed) && simAsleep.exchange(false)) wake(simWake);
+        }
+
+        // A full queue means the simulation is behind: hand out replies
+        // (so it is never stuck on this thread's outbox) and wait.
+        void send(Io& t, const Command& c) {
+            while (!inbox.push(c)) {
+                if (stopping.load(std::memory_order_relaxed)) return;
+                deliver(t);
+                notifySim();
+                std::this_thread::yield();
+            }
+            t.pushed = true;
+        }
+
+        void ioLoop(unsigned i) {
+            Io& t = *io[i];
+            epoll_event events[256];
+            while (!stopping.load(std::memory_order_relaxed)) {
+                int n = epoll_wait(t.epollFd, events, 256, -1);
+                if (n < 0 && errno != EINTR) break;
+                for (int k = 0; k < n; ++k) {
+                    const uint64_t tag = events[k].data.u64;
+                    if (tag == listenTag) acceptAll(i);
+                    else if (tag == wakeTag) { uint64_t v; (void)!read(t.wakeFd, &v, sizeof v); }
+                    else onReadable(i, (uint32_t)tag);
+                }
+                deliver(t);
+                for (uint32_t slot : t.dropped) close(i, slot);
+                t.dropped.clear();
+                if (t.pushed) { t.pushed = false; notifySim(); }
+            }
+        }
+
+        // Out of descriptors, the pending connection stays queued and the
+        // listener stays readable, so a thread that cannot accept stops
+        // watching it until some session closes rather than spin. It tries
+        // once more after pausing, in case a session closed in between.
+        void acceptAll(unsigned i) {
+            Io& t = *io[i];
+            bool paused = false;
+            while (true) {
+                int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) {
+                    if (paused || (errno != EMFILE && errno != ENFILE && errno != ENOBUFS && errno != ENOMEM)) return;
+                    pauseAccept(t);
+                    paused = true;
+                    continue;
+                }
+                if (paused) { resumeAccept(); paused = false; }
+                uint32_t slot;
+                if (!t.freeSlots.empty()) { slot = t.freeSlots.back(); t.freeSlots.pop_back(); }
+                else { slot = (uint32_t)t.sessions.size(); t.sessions.emplace_back(); }
+                Session& s = t.sessions[slot];
+                s.fd = fd;
+                s.gen++;
+                s.inLen = 0;
+                s.discarding = false;
+                watch(t, fd, slot, EPOLLIN);
+                send(t, Command{ slot, s.gen, 0, (uint8_t)i, Op::Join });
+            }
+        }
+
+        void close(unsigned i, uint32_t slot) {
+            Io& t = *io[i];
+            Session& s = t.sessions[slot];
+            if (s.fd < 0) return;
+            ::close(s.fd);  // also drops it from the epoll set
+            s.fd = -1;
+            t.freeSlots.push_back(slot);
+            send(t, Command{ slot, s.gen, 0, (uint8_t)i, Op::Leave });
+            resumeAccept();
+        }
+
+        // EPOLLEXCLUSIVE cannot be changed with EPOLL_CTL_MOD, so pausing
+        // removes the listener and resuming adds it back, for every
+        // thread that paused.
+        void pauseAccept(Io& t) {
+            std::lock_guard<std::mutex> lock(acceptLock);
+            if (t.acceptPaused) return;
+            epoll_ctl(t.epollFd, EPOLL_CTL_DEL, listenFd, nullptr);
+            t.acceptPaused = true;
+            acceptPaused.store(true);
+        }
+
+        void resumeAccept() {
+            if (!acceptPaused.load()) return;
+            std::lock_guard<std::mutex> lock(acceptLock);
+            for (auto& t : io) {
+                if (!t->acceptPaused) continue;
+                watch(*t, listenFd, listenTag, EPOLLIN | EPOLLEXCLUSIVE);
+                t->acceptPaused = false;
+            }
+            acceptPaused.store(false);
+        }
+
+        void onReadable(unsigned i, uint32_t slot) {
+            Session& s = io[i]->sessions[slot];
+            char buf[4096 + sizeof s.in];
+            std::memcpy(buf, s.in, s.inLen);
+            ssize_t n = read(s.fd, buf + s.inLen, 4096);
+            if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+            if (n <= 0) { close(i, slot); return; }
+            size_t len = s.inLen + (size_t)n, start = 0;
+            for (size_t k = s.inLen; k < len; ++k) {
+                if (buf[k] != '\n') continue;
+                if (s.discarding) s.discarding = false;  // end of an overlong line
+                else {
+                    Command c = parse(std::string_view(buf + start, k - start));
+                    c.slot = slot; c.gen = s.gen; c.io = (uint8_t)i;
+                    send(*io[i], c);
+                }
+                start = k + 1;
+            }
+            s.inLen = 0;
+            if (!s.discarding && len - start > sizeof s.in) {
+                send(*io[i], Command{ slot, s.gen, 0, (uint8_t)i, Op::Invalid });  // overlong line: answered once, the rest up to '\n' is dropped
+                s.discarding = true;
+            }
+            if (!s.discarding) { s.inLen = (uint8_t)(len - start); std::memcpy(s.in, buf + start, s.inLen); }
+        }
+
+        // Replies are short and a client waits for each one, so a full
+        // socket buffer means the client stopped reading: it is dropped. So
+        // is one that already hung up (MSG_NOSIGNAL: no SIGPIPE).
+        void deliver(Io& t) {
+            Reply r;
+            while (t.outbox.pop(r)) {
+                Session& s = t.sessions[r.slot];
+                if (s.fd < 0 || s.gen != r.gen) continue;  // the session it was for has gone
+                if (::send(s.fd, r.text, r.len, MSG_NOSIGNAL) != (ssize_t)r.len) t.dropped.push_back(r.slot);
+            }
+        }
+
+        void reply(const Reply& r, unsigned i) {
+            Io& t = *io[i];
+            while (!t.outbox.push(r)) {
+                if (stopping.load(std::memory_order_relaxed)) return;
+                wake(t.wakeFd);
+                std::this_thread::yield();
+            }
+        }
+
+        void simLoop() {
+            headless.quiet = true;
+            headless.policy = scriptedPolicy;
+            rng.seed(cfg.seed);
+            const World world = buildWorld();
+            population.assign(world.size(), 0);
+            std::vector<char> touched(io.size(), 0);
+            Command c;
+            while (true) {
+                // One tick: everything queued, up to maxBatch, then one
+                // wakeup per I/O thread with replies waiting.
+                size_t n = 0;
+                while (n < cfg.maxBatch && inbox.pop(c)) {
+                    apply(c, world);
+                    touched[c.io] = 1;
+                    n++;
+                }
+                if (n > 0) {
+                    ticks.fetch_add(1, std::memory_order_relaxed);
+                    commands.fetch_add((long long)n, std::memory_order_relaxed);
+                    for (size_t i = 0; i < io.size(); ++i) if (touched[i]) { touched[i] = 0; wake(io[i]->wakeFd); }
+                    continue;
+                }
+                if (stopping.load()) break;
+                simAsleep.store(true);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (inbox.empty()) {
+                    pollfd p{ simWake, POLLIN, 0 };
+                    ::poll(&p, 1, 100);
+                    uint64_t v;
+                    (void)!read(simWake, &v, sizeof v);
+                }
+                simAsleep.store(false);
+            }
+        }
+
+        void apply(const Command& c, const World& world) {
+            auto& slots = heroes[c.io];
+            Reply r{ c.slot, c.gen, 0, {} };
+            Line out{ r };
+            if (c.op == Op::Join) {
+                if (slots.size() <= c.slot) slots.resize(c.slot + 1);
+                slots[c.slot] = Hero{ newHero(), -1 };
+                peak = std::max(peak, (size_t)online.fetch_add(1, std::memory_order_relaxed) + 1);
+                out << "ready " << (long long)world.size();
+                out.end();
+                reply(r, c.io);
+                return;
+            }
+            Hero& h = slots[c.slot];
+            if (c.op == Op::Leave) {
+                if (h.location >= 0) population[h.location]--;
+                h = Hero{};
+                online.fetch_sub(1, std::memory_order_relaxed);
+                return;
+            }
+            Player& p = h.p;
+            bool stats = true;  // ends with "<level> <hp> <maxHp> <gold>"
+            switch (c.op) {
+            case Op::Explore:
+                if (c.arg < 1 || c.arg > (int)world.size()) { out << "invalid"; stats = false; break; }
+                if (h.location >= 0) population[h.location]--;
+                h.location = c.arg - 1;
+                population[h.location]++;
+                switch (explore(p, world[h.location])) {
+                case ExploreEvent::Fight: out << (p.hp > 0 ? "won" : "lost"); break;
+                case ExploreEvent::Gold: out << "gold"; break;
+                case ExploreEvent::Potion: out << "potion"; break;
+                case ExploreEvent::Rest: out << "rest"; break;
+                }
+                break;
+            case Op::Rest:
+                if (p.gold < 10) out << "poor";
+                else { p.gold -= 10; p.hp = p.maxHp; out << "rested"; }
+                break;
+            case Op::Buy:
+                if (c.arg < 1 || c.arg > (int)Content::pack().shopSize()) { out << "invalid"; stats = false; }
+                else out << (buyItem(p, Content::pack().shopItem(c.arg - 1)) ? "bought" : "poor");
+                break;
+            case Op::Use:
+                if (c.arg < 1 || c.arg > (int)p.inv.size()) { out << "invalid"; stats = false; }
+                else { useItem(p, c.arg - 1); out << "used"; }
+                break;
+            case Op::Who:
+                out << "who " << online.load(std::memory_order_relaxed) << " " << (long long)(h.location >= 0 ? population[h.location] : 0);
+                stats = false;
+                break;
+            default:
+                out << "invalid";
+                stats = false;
+                break;
+            }
+            if (stats) out << " " << (long long)p.level << " " << (long long)p.hp << " " << (long long)p.maxHp << " " << (long long)p.gold;
+            out.end();
+            reply(r, c.io);
+        }
+    };
+
+    // Load generator: `players` connections at once, each sending
+    // `commands` commands, one at a time, then hanging up. The bot rests
+    // at the inn when hurt and otherwise explores the place for its level.
+    struct LoadResult {
+        long long players = 0, requests = 0, errors = 0;
+        double secs = 0;
+        std::vector<uint32_t> latencyNs;  // one per command
+    };
+
+    class LoadClient {
+    public:
+        LoadClient(const std::string& path, int commands) : path(path), commands(commands) {}
+
+        bool run(int players, LoadResult& r, std::string& error) {
+            epollFd = epoll_create1(EPOLL_CLOEXEC);
+            if (epollFd < 0) { error = std::string("epoll: ") + std::strerror(errno); return false; }
+            clients.assign((size_t)players, Client{});
+            r.latencyNs.reserve((size_t)players * commands);
+            auto t0 = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < clients.size(); ++i) if (!connect(i, error)) return false;
+            int live = players;
+            epoll_event events[256];
+            while (live > 0) {
+                int n = epoll_wait(epollFd, events, 256, 5000);
+                if (n < 0 && errno != EINTR) { error = std::string("epoll: ") + std::strerror(errno); return false; }
+                if (n == 0) { error = "server stopped answering"; return false; }
+                for (int i = 0; i < n; ++i) {
+                    uint32_t slot = events[i].data.u32;
+                    if (onReadable(slot, r)) continue;
+                    ::close(clients[slot].fd);
+                    r.players++;
+                    live--;
+                }
+            }
+            r.secs = secondsSince(t0);
+            ::close(epollFd);
+            return true;
+        }
+
+    private:
+        struct Client {
+            int fd = -1;
+            int left = 0, sent = 0, locations = 0;
+            int level = 1, hp = 1, maxHp = 1, gold = 0;
+            std::chrono::steady_clock::time_point sentAt;
+            uint8_t inLen = 0;
+            char in[63];
+        };
+
+        std::string path;
+        int commands;
+        int epollFd = -1;
+        std::vector<Client> clients;
+
+        bool connect(uint32_t slot, std::string& error) {
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::memcpy(addr.sun_path, path.c_str(), std::min(path.size() + 1, sizeof addr.sun_path - 1));
+            int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            // Blocking connect: waits while the server's accept backlog is full.
+            if (fd < 0 || ::connect(fd, (sockaddr*)&addr, sizeof addr) < 0) {
+                error = "cannot connect to " + path + ": " + std::strerror(errno);
+                if (fd >= 0) ::close(fd);
+                return false;
+            }
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            Client& c = clients[slot];
+            c = Client{};
+            c.fd = fd;
+            c.left = commands;
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.u32 = slot;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+            return true;
+        }
+
+        bool send(Client& c) {
+            char line[32];
+            int n;
+            if (++c.sent % 16 == 0) n = std::snprintf(line, sizeof line, "who\n");
+            else if (c.hp * 100 < c.maxHp * 40 && c.gold >= 10) n = std::snprintf(line, sizeof line, "rest\n");
+            else n = std::snprintf(line, sizeof line, "explore %d\n", std::min(c.locations, 1 + (c.level - 1) / 2));
+            c.sentAt = std::chrono::steady_clock::now();
+            return write(c.fd, line, (size_t)n) == n;
+        }
+
+        // False once the player is done (or broken).
+        bool onReadable(uint32_t slot, LoadResult& r) {
+            Client& c = clients[slot];
+            char buf[512];
+            std::memcpy(buf, c.in, c.inLen);
+            ssize_t n = read(c.fd, buf + c.inLen, sizeof buf - c.inLen);
+            if (n < 0 && (errno == EAGAIN || errno == EINTR)) return true;
+            if (n <= 0) { r.errors++; return false; }
+            size_t len = c.inLen + (size_t)n, start = 0;
+            for (size_t i = c.inLen; i < len; ++i) {
+                if (buf[i] != '\n') continue;
+                std::string_view line(buf + start, i - start);
+                start = i + 1;
+                const std::string_view word = line.substr(0, line.find(' '));
+                const char* at = line.data() + word.size();
+                const char* end = line.data() + line.size();
+                auto next = [&](int& v) {
+                    if (at == end) return false;
+                    auto res = std::from_chars(at + 1, end, v);
+                    at = res.ptr;
+                    return res.ec == std::errc();
+                };
+                if (word == "ready") {
+                    if (!next(c.locations) || c.locations < 1) { r.errors++; return false; }
+                } else {
+                    r.latencyNs.push_back((uint32_t)std::min<long long>(0xFFFFFFFFLL,
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - c.sentAt).count()));
+                    r.requests++;
+                    if (word == "invalid") { r.errors++; return false; }
+                    if (word != "who" && !(next(c.level) && next(c.hp) && next(c.maxHp) && next(c.gold))) { r.errors++; return false; }
+                    if (--c.left == 0) return false;
+                }
+                if (!send(c)) { r.errors++; return false; }
+            }
+            c.inLen = (uint8_t)std::min(len - start, sizeof c.in);
+            std::memcpy(c.in, buf + start, c.inLen);
+            return true;
+        }
+    };
+
+    // A player holds a descriptor on each side, so lift the soft limit as
+    // far as the hard one allows.
+    inline long raiseFdLimit() {
+        rlimit lim{};
+        if (getrlimit(RLIMIT_NOFILE, &lim) != 0) return 1024;
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+        getrlimit(RLIMIT_NOFILE, &lim);
+        return lim.rlim_cur == RLIM_INFINITY ? 1L << 20 : (long)lim.rlim_cur;
+    }
+}
+
+// rpg --serve [socket] [io-threads]: hosts the shared world until interrupted.
+int runServe(const std::string& path, unsigned ioThreads) {
+    Realm::raiseFdLimit();
+    Realm::Config cfg;
+    cfg.ioThreads = std::clamp(ioThreads, 1u, Realm::maxIoThreads);
+    cfg.seed = std::random_device{}();
+    Realm::Server server(cfg);
+    std::string error;
+    if (!server.listen(path, error)) { std::cerr << error << "\n"; return 1; }
+    std::cout << "Serving " << buildWorld().size() << " locations on " << path << " with " << cfg.ioThreads << " I/O threads\n" << std::flush;
+    server.run();
+    return 0;
+}
+
+// rpg --serve-bench [commands] [io-threads]: the server, and a load
+// generator in a forked process (so each side has the whole descriptor
+// limit for its own end of the sockets), at 10 to 10k players each sending
+// `commands` commands. Reports simulation ticks/sec and batch size, and
+// round-trip latency as the clients saw it. Exits non-zero on any
+// protocol error.
+int runServeBench(int commands, unsigned ioThreads) {
+    const long fdLimit = Realm::raiseFdLimit();
+    const std::string path = "rpg_serve_bench.sock";
+    const int counts[] = { 10, 100, 1000, 5000, 10000 };
+
+    // What the load generator sends back per player count.
+    struct Row { long long players, requests, errors; double secs, p50, p99, p999; bool ok; };
+    int down[2], up[2];
+    if (pipe(down) != 0 || pipe(up) != 0) { std::cerr << "pipe: " << std::strerror(errno) << "\n"; return 1; }
+    // Fork before any thread exists; the child only ever runs LoadClient.
+    const pid_t child = fork();
+    if (child < 0) { std::cerr << "fork: " << std::strerror(errno) << "\n"; return 1; }
+    if (child == 0) {
+        ::close(down[1]); ::close(up[0]);
+        int players;
+        while (read(down[0], &players, sizeof players) == sizeof players && players > 0) {
+            Realm::LoadResult r;
+            std::string error;
+            Row row{};
+            row.ok = Realm::LoadClient(path, commands).run(players, r, error);
+            if (!row.ok) std::cerr << error << "\n";
+            std::vector<uint32_t>& lat = r.latencyNs;
+            auto pct = [&](double q) -> double {
+                if (lat.empty()) return 0;
+                size_t k = std::min(lat.size() - 1, (size_t)(q * (double)lat.size()));
+                std::nth_element(lat.begin(), lat.begin() + (long)k, lat.end());
+                return lat[k] / 1000.0;
+            };
+            row.players = r.players; row.requests = r.requests; row.errors = r.errors; row.secs = r.secs;
+            row.p50 = pct(0.50); row.p99 = pct(0.99); row.p999 = pct(0.999);
+            if (write(up[1], &row, sizeof row) != sizeof row) break;
+        }
+        _exit(0);
+    }
+    ::close(down[0]); ::close(up[1]);
+
+    Realm::Config cfg;
+    cfg.ioThreads = std::clamp(ioThreads, 1u, Realm::maxIoThreads);
+    Realm::Server server(cfg);
+    std::string error;
+    int rc = 0;
+    if (!server.listen(path, error)) { std::cerr << error << "\n"; rc = 1; }
+    std::thread serverThread;
+    if (rc == 0) serverThread = std::thread([&] { server.run(); });
+    if (rc == 0) {
+        std::cout << Color::bold << "\n== Shared world: " << cfg.ioThreads << " I/O threads, " << commands << " commands per player ==" << Color::reset << "\n";
+        std::cout << " players   commands/s     ticks/s  per tick  latency p50 (us)       p99     p99.9\n";
+    }
+    for (int players : counts) {
+        if (rc != 0) break;
+        if (players + 64L > fdLimit) {
+            std::cout << std::setw(8) << players << "  skipped, descriptor limit " << fdLimit << "\n";
+            continue;
+        }
+        const long long ticks0 = server.ticks.load(), commands0 = server.commands.load();
+        Row row{};
+        if (write(down[1], &players, sizeof players) != sizeof players || read(up[0], &row, sizeof row) != sizeof row || !row.ok) { rc = 1; break; }
+        const long long ticks = server.ticks.load() - ticks0, handled = server.commands.load() - commands0;
+        std::cout << std::fixed << std::setprecision(0) << std::setw(8) << players << std::setw(13) << row.requests / row.secs
+                  << std::setw(12) << ticks / row.secs << std::setprecision(1) << std::setw(10) << (double)handled / std::max(1LL, ticks)
+                  << std::setw(18) << row.p50 << std::setw(10) << row.p99 << std::setw(10) << row.p999;
+        if (row.errors || row.players != players) { std::cout << "  " << row.errors << " errors"; rc = 1; }
+        std::cout << "\n";
+    }
+    const int done = 0;
+    (void)!write(down[1], &done, sizeof done);
+    ::close(down[1]); ::close(up[0]);
+    waitpid(child, nullptr, 0);
+    if (serverThread.joinable()) {
+        server.stop();
+        serverThread.join();
+        std::cout << std::defaultfloat << "Peak players online: " << server.peak << "; " << sizeof(Realm::Command) << "-byte commands, "
+                  << sizeof(Realm::Reply) << "-byte replies\n";
+    }
+    std::cout << (rc == 0 ? "PASS" : "FAIL") << "\n";
+    return rc;
+}
+#endif
+
+int main(int argc, char** argv) {
+    std::ios::sync_with_stdio(false);
+    std::cin.tie(nullptr);
+#ifdef _WIN32
+    // Switch console to UTF-8 and enable ANSI colors on Windows
+    SetConsoleOutputCP(65001);
+    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+    if (hOut != INVALID_HANDLE_VALUE) {
+        DWORD mode = 0; GetConsoleMode(hOut, &mode);
+        mode |= 0x0004; // ENABLE_VIRTUAL_TERMINAL_PROCESSING
+        SetConsoleMode(hOut, mode);
+    }
+#endif
+
+    // Options that may precede any mode:
+    //   --content <pack>  use this content pack. Without it only the game
+    //                     itself looks for content.bin, then content.txt.
+    //   --profile         time instrumented phases, print a summary at exit
+    //   --trace <file>    --profile, plus a Chrome trace-event JSON file
+    bool explicitContent = false;
+    Trace::ExitReport profileReport;
+    while (argc > 1) {
+        std::string opt = argv[1];
+        if (opt == "--content" && argc > 2) {
+            std::string error;
+            if (!Content::load(argv[2], error)) { std::cerr << error << "\n"; return 1; }
+            explicitContent = true;
+            argc -= 2; argv += 2;
+        } else if (opt == "--profile") {
+            Trace::start(false);
+            argc -= 1; argv += 1;
+        } else if (opt == "--trace" && argc > 2) {
+            Trace::start(true);
+            profileReport.tracePath = argv[2];
+            argc -= 2; argv += 2;
+        } else {
+            break;
+        }
+    }
+#ifdef RPG_NO_TRACE
+    if (Trace::enabled) std::cerr << "built with RPG_NO_TRACE: no phases are instrumented\n";
+#endif
+
+    std::string mode = argc > 1 ? argv[1] : "";
+    if (mode == "--sim") return runSim(argc > 2 ? std::atoll(argv[2]) : 100000, argc > 3 ? (unsigned)std::atoll(argv[3]) : std::random_device{}());
+    if (mode == "--bench") return runBench(argc > 2 ? std::atoll(argv[2]) : 200000);
+    if (mode == "--damage-check") return runDamageCheck(argc > 2 ? std::atoll(argv[2]) : 200000);
+    if (mode == "--save-bench") return runSaveBench(argc > 2 ? std::atoll(argv[2]) : 10000);
+    if (mode == "--inventory-bench") return runInventoryBench();
+    if (mode == "--alloc-report") return runAllocReport(argc > 2 ? std::atoll(argv[2]) : 100000);
+    if (mode == "--batch") return runBatchBench(argc > 2 ? std::atoll(argv[2]) : 200000);
+    if (mode == "--balance") return runBalanceCommand(argc > 2 ? std::atoll(argv[2]) : 100000, argc > 3 ? (unsigned)std::atoll(argv[3]) : 1,
+                                                      argc > 4 ? (unsigned)std::atoll(argv[4]) : std::max(1u, std::thread::hardware_concurrency()));
+
+    if (mode == "--render-bench") return runRenderBench(argc > 2 ? std::atoll(argv[2]) : 100000);
+    if (mode == "--pack-compile" && argc > 3) return runPackCompile(argv[2], argv[3]);
+    if (mode == "--pack-export" && argc > 2) return runPackExport(argv[2]);
+    if (mode == "--alias-bench") return runAliasBench(argc > 2 ? std::atoll(argv[2]) : 10000000);
+    if (mode == "--rng-bench") return runRngBench(argc > 2 ? std::atoll(argv[2]) : 50000000);
+    if (mode == "--alias-check") return runAliasCheck(argc > 2 ? std::atoll(argv[2]) : 1000000);
+    if (mode == "--pack-bench") return runPackBench(argc > 2 ? std::atoll(argv[2]) : 100000);
+    if (mode == "--journal-bench") return runJournalBench(argc > 2 ? std::atoll(argv[2]) : 100000, argc > 3 ? std::atoll(argv[3]) : 10000);
+    if (mode == "--gear-bench") return runGearBench(argc > 2 ? std::atoll(argv[2]) : 2000, argc > 3 ? std::atoll(argv[3]) : 2000);
+    if (mode == "--odds-check") return runOddsCheck(argc > 2 ? std::atoll(argv[2]) : 200000);
+    if (mode == "--level-bench") return runLevelBench(argc > 2 ? std::atoll(argv[2]) : 1000);
+    if (mode == "--input-bench") return runInputBench(argc > 2 ? std::atoll(argv[2]) : 1000000);
+    if (mode == "--tune") return runTuneCommand(argc > 2 ? std::atoi(argv[2]) : 30, argc > 3 ? std::atoi(argv[3]) : 16,
+                                                argc > 4 ? std::atoll(argv[4]) : 2000, argc > 5 ? std::atoll(argv[5]) : 1,
+                                                argc > 6 ? argv[6] : "tuned.txt");
+    if (mode == "--serve" || mode == "--serve-bench") {
+#ifdef __linux__
+        unsigned ioThreads = 2;
+        if (argc > 3) {
+            const char* end = argv[3] + std::strlen(argv[3]);
+            auto r = std::from_chars(argv[3], end, ioThreads);
+            if (r.ec != std::errc() || r.ptr != end || ioThreads < 1 || ioThreads > Realm::maxIoThreads) {
+                std::cerr << "I/O threads must be 1 to " << Realm::maxIoThreads << "\n";
+                return 1;
+            }
+        }
+        if (mode == "--serve-bench") return runServeBench(argc > 2 ? std::atoi(argv[2]) : 20, ioThreads);
+        return runServe(argc > 2 ? argv[2] : "rpg.sock", ioThreads);
+#else
+        std::cerr << mode << " needs Linux (epoll and Unix domain sockets)\n";
+        return 1;
+#endif
+    }
+    if (mode == "--replay-bench") return runReplayBench(argc > 2 ? std::atoll(argv[2]) : 100000);
+    if (mode == "--no-render") screen.render = false;
+
+    for (const char* path : { "content.bin", "content.txt" }) {
+        if (explicitContent || !std::ifstream(path)) continue;
+        std::string error;
+        if (!Content::load(path, error)) screen << Color::red << error << Color::reset << "\n";
+        break;
+    }
+    // After the auto-load: the log's content hash must match the pack it recorded with.
+    if (mode == "--replay" && argc > 2) return runReplay(argv[2]);
+
+    // --record <log> [seed]: play normally, logging the seed and every input.
+    bool recording = mode == "--record" && argc > 2;
+    if (recording) {
+        unsigned seed = argc > 3 ? (unsigned)std::atoll(argv[3]) : std::random_device{}();
+        rng.seed(seed);
+        const uint64_t hash = contentHash();
+        if (!input.startRecording(argv[2], seed, std::string_view((const char*)&hash, sizeof hash))) { std::cerr << "cannot write " << argv[2] << "\n"; return 1; }
+    }
+
+    // Autosave is off while recording: a resumed game is not in the log.
+    Autosave::Journal journal(saveFile);
+    Player p = playSession(recording ? nullptr : &journal);
+    if (recording) input.finish(stateDigest(p));
     return 0;
 }
 
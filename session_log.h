@@ -0,0 +1,186 @@
+// Session logs shared by game.cpp and rpg.cpp.
+//
+// A log holds the RNG seed plus every line of input, so a session can be
+// replayed exactly. Records are a tag byte and a LEB128 length:
+//   Header | extra | ('I' len bytes | 'F' len bytes)* | ['E' digest]
+// Each game has its own magic and a fixed number of `extra` header bytes
+// (rpg.cpp: its content pack hash). 'F' holds a file the session loaded, so
+// a replay reads it from the log rather than from disk. 'E' holds a digest
+// of the final state when the session ended normally.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "input.h"
+#include "mapped_file.h"
+#include "rng.h"
+
+namespace SessionLog {
+    constexpr uint32_t version = Rand::streamVersion;  // a seed replays only on the same generator
+    constexpr char tagInput = 'I', tagFile = 'F', tagEnd = 'E';
+
+    struct Header { char magic[4]; uint32_t version; uint64_t seed; };
+    static_assert(sizeof(Header) == 16, "log header must stay unpadded");
+
+    inline uint64_t fnv1a(std::string_view data, uint64_t h = 1469598103934665603ULL) {
+        for (unsigned char c : data) { h ^= c; h *= 1099511628211ULL; }
+        return h;
+    }
+
+    // The header and its extra bytes, which start every log.
+    inline std::string start(const char* magic, uint64_t seed, std::string_view extra = {}) {
+        Header h{};
+        std::memcpy(h.magic, magic, 4);
+        h.version = version;
+        h.seed = seed;
+        std::string out((const char*)&h, sizeof h);
+        out.append(extra.data(), extra.size());
+        return out;
+    }
+
+    inline void putRecord(std::string& out, char tag, std::string_view data) {
+        out.push_back(tag);
+        for (uint64_t n = data.size(); ; n >>= 7) {
+            if (n < 0x80) { out.push_back((char)n); break; }
+            out.push_back((char)(0x80 | (n & 0x7f)));
+        }
+        out.append(data.data(), data.size());
+    }
+
+    inline void putInput(std::string& out, std::string_view line) { putRecord(out, tagInput, line); }
+
+    inline void putEnd(std::string& out, uint64_t digest) {
+        out.push_back(tagEnd);
+        out.append((const char*)&digest, sizeof digest);
+    }
+}
+
+// Source of all interactive input: the terminal, optionally recorded to a
+// session log, or a session log replayed from memory. Lines are returned
+// without their newline; in replay they point straight into the mapped log.
+class Input {
+public:
+    long long lines = 0;  // lines handed out so far
+
+    // magic: the game's log tag; extraBytes: the size of its header extra.
+    explicit Input(const char* magic, size_t extraBytes = 0) : extraBytes(extraBytes) { std::memcpy(this->magic, magic, 4); }
+
+    bool replaying() const { return log != nullptr; }
+    bool recording() const { return record.is_open(); }
+    bool eof() const { return atEnd; }
+
+    // While line() waits on stdin, fn(ctx) runs every LineReader::idleMs.
+    void onIdle(void (*fn)(void*), void* ctx) { reader.idle = fn; reader.idleCtx = ctx; }
+
+    // Next line, or false once input is exhausted.
+    bool line(std::string_view& out) {
+        if (atEnd) return false;
+        if (log) {
+            if (!next(SessionLog::tagInput, out)) { atEnd = true; return false; }
+        } else {
+            if (!reader.line(out)) { atEnd = true; return false; }
+            if (record) {
+                pending.clear();
+                SessionLog::putInput(pending, out);
+                write();
+            }
+        }
+        lines++;
+        return true;
+    }
+
+    // A file the game loaded: logged while recording, and taken from the
+    // log (false if it is not next) while replaying.
+    void recordFile(std::string_view data) {
+        if (!record) return;
+        pending.clear();
+        SessionLog::putRecord(pending, SessionLog::tagFile, data);
+        write();
+    }
+
+    bool replayFile(std::string_view& out) { return log && !atEnd && next(SessionLog::tagFile, out); }
+
+    // extra must be extraBytes long.
+    bool startRecording(const std::string& path, uint64_t seed, std::string_view extra = {}) {
+        record.open(path, std::ios::binary | std::ios::trunc);
+        pending = SessionLog::start(magic, seed, extra);
+        write();
+        return (bool)record;
+    }
+
+    // On success extra points at the header's extra bytes, valid for the
+    // rest of the replay.
+    bool startReplay(const std::string& path, uint64_t& seed, std::string_view& extra, std::string& error) {
+        log = std::make_unique<MappedFile>(path);
+        SessionLog::Header h;
+        if (!log->ok() || log->size() < sizeof h + extraBytes) { error = "cannot read session log " + path; log.reset(); return false; }
+        std::memcpy(&h, log->data(), sizeof h);
+        if (std::memcmp(h.magic, magic, 4) != 0 || h.version != SessionLog::version) {
+            error = path + ": not a version " + std::to_string(SessionLog::version) + " session log";
+            if (std::memcmp(h.magic, magic, 4) == 0 && h.version == 1) error += " (recorded with mt19937: replay with a -DRNG_LEGACY_MT19937 build)";
+            log.reset();
+            return false;
+        }
+        seed = h.seed;
+        extra = std::string_view(log->data() + sizeof h, extraBytes);
+        pos = log->data() + sizeof h + extraBytes;
+        end = log->data() + log->size();
+        return true;
+    }
+
+    // Ends a recording with the final state digest.
+    void finish(uint64_t digest) {
+        if (!record) return;
+        pending.clear();
+        SessionLog::putEnd(pending, digest);
+        write();
+    }
+
+    // After a replay has run out of input: the recorded digest, if any.
+    bool recordedDigest(uint64_t& digest) const {
+        if (!log || pos >= end || *pos != SessionLog::tagEnd || end - pos < 1 + (ptrdiff_t)sizeof digest) return false;
+        std::memcpy(&digest, pos + 1, sizeof digest);
+        return true;
+    }
+
+    size_t logBytes() const { return log ? log->size() : 0; }
+
+private:
+    LineReader reader;  // stdin
+    char magic[4];
+    size_t extraBytes;
+    std::string pending;
+    std::ofstream record;
+    std::unique_ptr<MappedFile> log;
+    const char* pos = nullptr;
+    const char* end = nullptr;
+    bool atEnd = false;
+
+    // Flushed per record, so a crash loses at most the line in progress.
+    void write() {
+        record.write(pending.data(), (std::streamsize)pending.size());
+        record.flush();
+    }
+
+    // The next log record, if it has this tag.
+    bool next(char tag, std::string_view& out) {
+        if (pos >= end || *pos != tag) return false;
+        const char* p = pos + 1;
+        uint64_t n = 0;
+        bool complete = false;  // a log cut off inside the length is not a record
+        for (int shift = 0; p < end && shift < 64 && !complete; shift += 7) {
+            uint8_t b = (uint8_t)*p++;
+            n |= (uint64_t)(b & 0x7f) << shift;
+            complete = !(b & 0x80);
+        }
+        if (!complete || n > (uint64_t)(end - p)) return false;
+        out = std::string_view(p, (size_t)n);
+        pos = p + n;
+        return true;
+    }
+};